@@ -0,0 +1,41 @@
+#pragma once
+
+#include <functional>
+#include <QtConcurrent>
+
+#include "Query.h"
+#include "QueryError.h"
+
+/*!
+ * \brief runAsync  -- internal helper for generators' performAsync(): runs the job on the
+ * Query::asyncExecutor() pool, on a separate Query (so on the worker thread's own connection),
+ * converting query errors to QueryError exceptions, delivered through the future.
+ * \param origin    -- the Query the generator was created by, the worker Query gets it's table, pkey and tag
+ * \param job       -- performs the generator against the given worker Query
+ * \return          -- future with the job's result
+ */
+template<typename Result>
+QFuture<Result> runAsync(const Query& origin, const std::function<Result(const Query&)>& job)
+{
+    const QString tableName = origin.tableName();
+    const QString pkey = origin.primaryKeyName();
+    const QString tag = origin.tag();
+
+    return QtConcurrent::run(Query::asyncExecutor(), [tableName, pkey, tag, job]() -> Result {
+        try
+        {
+            Query query(tableName, pkey);
+            query.setTag(tag);
+
+            Result result = job(query);
+            if (query.hasError())
+                throw QueryError(query.lastError());
+
+            return result;
+        }
+        catch (const std::runtime_error& e)
+        {
+            throw QueryError(QSqlError(e.what(), QString(), QSqlError::ConnectionError));
+        }
+    });
+}
@@ -0,0 +1,335 @@
+#include "Batch.h"
+#include "Query.h"
+#include "Selector.h"
+#include "Inserter.h"
+#include "Upserter.h"
+#include "Updater.h"
+#include "Deleter.h"
+#include "PgNative.h"
+#include "SqlFormat.h"
+
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QElapsedTimer>
+
+#ifdef SQLBUILDER_LIBPQ
+#include <libpq-fe.h>
+#endif
+
+namespace
+{
+
+BatchResult emptyResult(BatchResult::Kind kind, const QSqlError& error)
+{
+    BatchResult result;
+    result.m_kind  = kind;
+    result.m_ok    = false;
+    result.m_error = error;
+    return result;
+}
+
+BatchResult decodeResult(BatchResult::Kind kind, QSqlQuery& q)
+{
+    BatchResult result = emptyResult(kind, q.lastError());
+
+    switch (kind)
+    {
+    case BatchResult::Select:
+    {
+        QSqlRecord r = q.record();
+        while(q.next())
+        {
+            QVariantMap resultRow;
+            for(int i = 0; i < r.count(); ++i)
+                resultRow[r.fieldName(i)] = q.value(i);
+
+            result.m_rows.append(resultRow);
+        }
+        break;
+    }
+    case BatchResult::Insert:
+        while(q.next())
+            result.m_ids.append(q.value(0).toInt());
+        break;
+    default:
+        result.m_ok = q.numRowsAffected() > 0;
+    }
+
+    return result;
+}
+
+#ifdef SQLBUILDER_LIBPQ
+BatchResult decodeResult(BatchResult::Kind kind, const PGresult* r)
+{
+    const ExecStatusType status = PQresultStatus(r);
+    if (status != PGRES_TUPLES_OK && status != PGRES_COMMAND_OK)
+    {
+        return emptyResult(kind, QSqlError(QString::fromUtf8(PQresultErrorMessage(r))
+                                           , QString()
+                                           , QSqlError::StatementError
+                                           , QString::fromLatin1(PQresultErrorField(r, PG_DIAG_SQLSTATE))));
+    }
+
+    BatchResult result = emptyResult(kind, QSqlError());
+
+    switch (kind)
+    {
+    case BatchResult::Select:
+        for (int row = 0; row < PQntuples(r); ++row)
+        {
+            QVariantMap resultRow;
+            for (int column = 0; column < PQnfields(r); ++column)
+                resultRow[QString::fromUtf8(PQfname(r, column))] = PgNative::value(r, row, column);
+
+            result.m_rows.append(resultRow);
+        }
+        break;
+    case BatchResult::Insert:
+        for (int row = 0; row < PQntuples(r); ++row)
+            result.m_ids.append(PgNative::value(r, row, 0).toInt());
+        break;
+    default:
+        result.m_ok = QByteArray(PQcmdTuples(const_cast<PGresult*>(r))).toInt() > 0;
+    }
+
+    return result;
+}
+#endif
+
+}
+
+/***************************************************************************************/
+
+struct Batch::BatchPrivate
+{
+    BatchPrivate(const Query* q)
+        : m_query(q)
+    {}
+
+    struct Statement
+    {
+        BatchResult::Kind   m_kind;
+        QString             m_sql;
+        QVariantList        m_values;
+        QString             m_writtenTable; // empty for SELECT
+    };
+
+    const Query*        m_query;
+    QList<Statement>    m_statements;
+
+    void add(BatchResult::Kind kind, QString sql, const QVariantList& values, const QString& writtenTable = QString())
+    {
+        // statements are joined by ';' later, an empty statement would shift the results
+        while (sql.endsWith(QLatin1Char(';')) || sql.endsWith(QLatin1Char(' ')))
+            sql.chop(1);
+
+        m_statements.append(Statement{kind, sql, values, writtenTable});
+    }
+
+    QString multiStatementSQL(const QSqlDriver* driver) const
+    {
+        QStringList parts;
+        for (const Statement& statement : m_statements)
+            parts << SqlFormat::inlineValues(driver, statement.m_sql, statement.m_values);
+
+        return parts.join(";\n");
+    }
+
+    QList<BatchResult> cancelledResults(const QSqlError& error) const
+    {
+        QList<BatchResult> results;
+        for (const Statement& statement : m_statements)
+            results.append(emptyResult(statement.m_kind, error));
+
+        return results;
+    }
+
+    // the statements before the failed one have not taken effect, their results are not kept
+    void markRolledBack(QList<BatchResult>& results) const
+    {
+        int failed = 0;
+        while (failed < results.count() && !results[failed].m_error.isValid())
+            ++failed;
+
+        if (failed == results.count())
+            return;
+
+        const QSqlError error(QString("Rolled back, statement %1 of the batch has failed: %2")
+                                    .arg(failed + 1).arg(results[failed].m_error.text())
+                              , QString(), QSqlError::TransactionError);
+        for (int i = 0; i < failed; ++i)
+            results[i] = emptyResult(results[i].m_kind, error);
+    }
+
+    QList<BatchResult> performNative(void* nativeConnection, const QString& sql) const
+    {
+        QList<BatchResult> results = cancelledResults(QSqlError("Not executed, the batch was cancelled"
+                                                                , QString(), QSqlError::TransactionError));
+#ifdef SQLBUILDER_LIBPQ
+        PGconn* conn = static_cast<PGconn*>(nativeConnection);
+
+        if (!PQsendQuery(conn, sql.toUtf8().constData()))
+            return cancelledResults(QSqlError(QString::fromUtf8(PQerrorMessage(conn)), QString(), QSqlError::ConnectionError));
+
+        int index = 0;
+        while (PGresult* r = PQgetResult(conn))
+        {
+            if (index < results.count())
+                results[index] = decodeResult(results[index].m_kind, r);
+
+            PQclear(r);
+            ++index;
+        }
+#else
+        Q_UNUSED(nativeConnection) Q_UNUSED(sql)
+#endif
+        return results;
+    }
+
+    QList<BatchResult> performMultipleResults(const QSqlDatabase& db, const QString& sql) const
+    {
+        QSqlQuery q(db);
+        q.setForwardOnly(true);
+        if (!q.exec(sql))
+            return cancelledResults(q.lastError());
+
+        QList<BatchResult> results;
+        for (const Statement& statement : m_statements)
+        {
+            results.append(decodeResult(statement.m_kind, q));
+            if (!q.nextResult())
+                break;
+        }
+
+        while (results.count() < m_statements.count())
+            results.append(emptyResult(m_statements[results.count()].m_kind, QSqlError("No result", QString(), QSqlError::StatementError)));
+
+        return results;
+    }
+
+    QList<BatchResult> performSequential() const
+    {
+        QList<BatchResult> results;
+        for (const Statement& statement : m_statements)
+        {
+            QSqlQuery q = m_query->performSQL(statement.m_sql, statement.m_values);
+            results.append(decodeResult(statement.m_kind, q));
+            q.finish();
+        }
+
+        return results;
+    }
+};
+
+/***************************************************************************************/
+
+Batch::Batch(const Query* q)
+    : impl(new BatchPrivate(q))
+{ }
+
+Batch::~Batch()
+{ }
+
+Batch::Batch(Batch &&) = default;
+
+Batch Batch::add(Selector&& selector) &&
+{
+    QVariantList values;
+    const QString sql = selector.buildSQL(values);
+
+    impl->add(BatchResult::Select, sql, values);
+    return std::move(*this);
+}
+
+Batch Batch::add(InserterPerformer&& inserter) &&
+{
+    QVariantList values;
+    const QString sql = inserter.buildSQL(values);
+
+    impl->add(BatchResult::Insert, sql, values, inserter.tableName());
+    return std::move(*this);
+}
+
+Batch Batch::add(Upserter&& upserter) &&
+{
+    QVariantList values;
+    const QString sql = upserter.buildSQL(values);
+
+    impl->add(BatchResult::Insert, sql, values, upserter.tableName());
+    return std::move(*this);
+}
+
+Batch Batch::add(Updater&& updater) &&
+{
+    QVariantList values;
+    const QString sql = updater.buildSQL(values);
+
+    impl->add(BatchResult::Update, sql, values, updater.tableName());
+    return std::move(*this);
+}
+
+Batch Batch::add(Deleter&& deleter) &&
+{
+    QVariantList values;
+    const QString sql = deleter.buildSQL(values);
+
+    impl->add(BatchResult::Delete, sql, values, deleter.tableName());
+    return std::move(*this);
+}
+
+QList<BatchResult> Batch::perform() &&
+{
+    QList<BatchResult> results;
+    if (impl->m_statements.isEmpty())
+        return results;
+
+    const QSqlDatabase db = impl->m_query->database();
+    void* nativeConnection = PgNative::connection(db);
+
+    if (nativeConnection || (db.isOpen() && db.driver()->hasFeature(QSqlDriver::MultipleResultSets)))
+    {
+        // one statement on the wire, one stats report; the sequential way reports each statement itself
+        QueryStats stats;
+        QElapsedTimer timer;
+        timer.start();
+
+        stats.m_sql = impl->multiStatementSQL(db.driver());
+        stats.m_generationNsecs = timer.nsecsElapsed();
+
+        results = nativeConnection ? impl->performNative(nativeConnection, stats.m_sql)
+                                   : impl->performMultipleResults(db, stats.m_sql);
+        stats.m_executionNsecs = timer.nsecsElapsed() - stats.m_generationNsecs;
+
+        // PostgreSQL runs the multi-statement query in one implicit transaction, a failure rolls back the statements
+        // before it as well; in the caller's transaction it's aborted anyway, so it's the caller's rollback then
+        if (nativeConnection && !Query::inTransaction())
+            impl->markRolledBack(results);
+
+        for (const BatchResult& result : results)
+            stats.m_rowCount += result.m_rows.count() + result.m_ids.count();
+        Query::reportStats(stats);
+    }
+    else
+        results = impl->performSequential();
+
+    for (const BatchPrivate::Statement& statement : impl->m_statements)
+    {
+        if (!statement.m_writtenTable.isEmpty())
+            impl->m_query->notifyWrite(statement.m_writtenTable);
+    }
+
+    QSqlError batchError;
+    for (const BatchResult& result : results)
+    {
+        if (result.m_error.isValid())
+        {
+            batchError = result.m_error;
+            break;
+        }
+    }
+    impl->m_query->setLastError(batchError);
+
+    return results;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <memory>
+#include <QVariant>
+#include <QSqlError>
+
+QT_FORWARD_DECLARE_CLASS(Query)
+QT_FORWARD_DECLARE_CLASS(Selector)
+QT_FORWARD_DECLARE_CLASS(InserterPerformer)
+QT_FORWARD_DECLARE_CLASS(Upserter)
+QT_FORWARD_DECLARE_CLASS(Updater)
+QT_FORWARD_DECLARE_CLASS(Deleter)
+
+/*!
+ * \brief The BatchResult struct
+ * is a result of one statement of the batch, only the part
+ * corresponding to the statement's kind is filled.
+ */
+struct BatchResult
+{
+    enum Kind
+    {
+        Select, // m_rows are filled, like Selector::perform() returns
+        Insert, // m_ids are filled, like InserterPerformer::perform() returns
+        Update, // m_ok is filled, like Updater::perform() returns
+        Delete  // m_ok is filled, like Deleter::perform() returns
+    };
+
+    Kind            m_kind;
+    QVariantList    m_rows;
+    QList<int>      m_ids;
+    bool            m_ok;
+
+    QSqlError       m_error;  // error of this very statement, if any
+};
+
+/*!
+ * \brief The Batch class
+ * is a generator, that collects several other generators and sends them all
+ * to the database at once, so that a request costs one round trip instead of several.
+ * On PostgreSQL (when built with libpq) the statements are sent as one multi-statement
+ * query, so they are also executed atomically: the first failing statement cancels the
+ * whole batch, every statement gets an error result, the ones before it are rolled back
+ * (in the caller's transaction they are rolled back with it). Drivers with multiple result sets support
+ * get the same multi-statement query through Qt. Otherwise the statements are just
+ * performed one by one on the Query's connection, as if you've called perform() on each.
+ * Values are inlined into the multi-statement text by the driver's own formatting rules,
+ * so don't put "?" characters into raw parts of the generators (field names, having()).
+ */
+class Batch
+{
+    Q_DISABLE_COPY(Batch)
+public:
+    /*!
+     * \brief Batch -- constructor of the generator, don't use it manually
+     * \param q     -- ptr to the Query class, that created it
+     */
+    explicit Batch(const Query* q);
+    ~Batch();
+
+    Batch(Batch&&);
+    Batch& operator=(Batch&&) = default;
+
+    /*!
+     * \brief add       -- adds SELECT query to the batch
+     * \param selector  -- configured select generator
+     * \return          -- this generator as rvalue to be reused
+     */
+    Batch add(Selector&& selector) &&;
+
+    /*!
+     * \brief add       -- adds INSERT query to the batch
+     * \param inserter  -- insert generator with values
+     * \return          -- this generator as rvalue to be reused
+     */
+    Batch add(InserterPerformer&& inserter) &&;
+
+    /*!
+     * \brief add       -- adds INSERT ... ON CONFLICT query to the batch, it's result is like the INSERT one
+     * \param upserter  -- upsert generator with values
+     * \return          -- this generator as rvalue to be reused
+     */
+    Batch add(Upserter&& upserter) &&;
+
+    /*!
+     * \brief add       -- adds UPDATE query to the batch
+     * \param updater   -- configured update generator
+     * \return          -- this generator as rvalue to be reused
+     */
+    Batch add(Updater&& updater) &&;
+
+    /*!
+     * \brief add       -- adds DELETE query to the batch
+     * \param deleter   -- configured delete generator
+     * \return          -- this generator as rvalue to be reused
+     */
+    Batch add(Deleter&& deleter) &&;
+
+    /*!
+     * \brief perform   -- executes all the collected queries
+     * \return          -- one result per added query, in order of adding,
+     * also check Query's hasError() if you want to ensure the whole batch succeeded
+     */
+    QList<BatchResult> perform() &&;
+
+private:
+    struct BatchPrivate;
+    std::unique_ptr<BatchPrivate> impl;
+};
@@ -0,0 +1,195 @@
+#include "ColumnarResult.h"
+
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlField>
+
+namespace
+{
+
+ColumnarResult::ColumnType columnTypeOf(QVariant::Type type)
+{
+    switch (type)
+    {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+        return ColumnarResult::Integer;
+    // values above INT64_MAX would wrap in qint64, they stay variants
+    case QVariant::ULongLong:
+        return ColumnarResult::Other;
+    case QVariant::Double:
+        return ColumnarResult::Real;
+    case QVariant::Bool:
+        return ColumnarResult::Boolean;
+    case QVariant::String:
+        return ColumnarResult::Text;
+    default:
+        return ColumnarResult::Other;
+    }
+}
+
+}
+
+ColumnarResult::ColumnarResult()
+    : m_rowCount(0)
+{ }
+
+int ColumnarResult::rowCount() const
+{
+    return m_rowCount;
+}
+
+int ColumnarResult::columnCount() const
+{
+    return m_columns.count();
+}
+
+QStringList ColumnarResult::columnNames() const
+{
+    return m_names;
+}
+
+int ColumnarResult::columnIndex(const QString& name) const
+{
+    return m_index.value(name, -1);
+}
+
+ColumnarResult::ColumnType ColumnarResult::columnType(int column) const
+{
+    return m_columns[column].m_type;
+}
+
+const QBitArray& ColumnarResult::nulls(int column) const
+{
+    return m_columns[column].m_nulls;
+}
+
+const QVector<qint64>& ColumnarResult::integers(int column) const
+{
+    return m_columns[column].m_integers;
+}
+
+const QVector<double>& ColumnarResult::reals(int column) const
+{
+    return m_columns[column].m_reals;
+}
+
+const QVector<bool>& ColumnarResult::booleans(int column) const
+{
+    return m_columns[column].m_booleans;
+}
+
+const QVector<QString>& ColumnarResult::texts(int column) const
+{
+    return m_columns[column].m_texts;
+}
+
+const QVector<QVariant>& ColumnarResult::variants(int column) const
+{
+    return m_columns[column].m_variants;
+}
+
+bool ColumnarResult::isNull(int row, int column) const
+{
+    return m_columns[column].m_nulls.testBit(row);
+}
+
+QVariant ColumnarResult::value(int row, int column) const
+{
+    const Column& c = m_columns[column];
+    if (c.m_nulls.testBit(row))
+        return QVariant();
+
+    switch (c.m_type)
+    {
+    case Integer:
+        return c.m_integers[row];
+    case Real:
+        return c.m_reals[row];
+    case Boolean:
+        return c.m_booleans[row];
+    case Text:
+        return c.m_texts[row];
+    default:
+        return c.m_variants[row];
+    }
+}
+
+QVariantMap ColumnarResult::row(int row) const
+{
+    QVariantMap result;
+    for (int i = 0; i < m_columns.count(); ++i)
+        result[m_names[i]] = value(row, i);
+
+    return result;
+}
+
+void ColumnarResult::setColumns(const QSqlRecord& record)
+{
+    m_rowCount = 0;
+    m_names.clear();
+    m_index.clear();
+    m_columns.clear();
+
+    for (int i = 0; i < record.count(); ++i)
+    {
+        Column column;
+        column.m_type = columnTypeOf(record.field(i).type());
+
+        m_names << record.fieldName(i);
+        m_index.insert(record.fieldName(i), i);
+        m_columns.append(column);
+    }
+}
+
+void ColumnarResult::appendRow(const QSqlQuery& q)
+{
+    for (int i = 0; i < m_columns.count(); ++i)
+    {
+        Column& c = m_columns[i];
+
+        // the bitmap grows geometrically, squeeze() cuts it to the row count
+        if (m_rowCount >= c.m_nulls.size())
+            c.m_nulls.resize(qMax(64, c.m_nulls.size() * 2));
+
+        const QVariant value = q.value(i);
+        const bool isNull = value.isNull();
+        if (isNull)
+            c.m_nulls.setBit(m_rowCount);
+
+        switch (c.m_type)
+        {
+        case Integer:
+            c.m_integers.append(isNull ? 0 : value.toLongLong());
+            break;
+        case Real:
+            c.m_reals.append(isNull ? 0.0 : value.toDouble());
+            break;
+        case Boolean:
+            c.m_booleans.append(isNull ? false : value.toBool());
+            break;
+        case Text:
+            c.m_texts.append(isNull ? QString() : value.toString());
+            break;
+        default:
+            c.m_variants.append(value);
+        }
+    }
+
+    ++m_rowCount;
+}
+
+void ColumnarResult::squeeze()
+{
+    for (Column& c : m_columns)
+    {
+        c.m_nulls.resize(m_rowCount);
+
+        c.m_integers.squeeze();
+        c.m_reals.squeeze();
+        c.m_booleans.squeeze();
+        c.m_texts.squeeze();
+        c.m_variants.squeeze();
+    }
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <QVariant>
+#include <QVector>
+#include <QHash>
+#include <QBitArray>
+#include <QStringList>
+
+QT_FORWARD_DECLARE_CLASS(QSqlQuery)
+QT_FORWARD_DECLARE_CLASS(QSqlRecord)
+
+/*!
+ * \brief The ColumnarResult class
+ * is a column-oriented alternative to the list of maps Selector::perform() returns.
+ * Column names are stored once, each column keeps it's values in one contiguous vector
+ * of the column's type plus a bitmap of nulls, so there are no per-row maps and keys: numbers
+ * and booleans are stored unboxed, text cells are still a QString each. The values are read through
+ * QSqlQuery::value() as the driver gives them, that part costs the same as for perform().
+ * Only the vector of the column's own type is filled, the accessors of other types return
+ * empty vectors; null cells hold default values there (check nulls()). It is a value class,
+ * copying is cheap, the data is implicitly shared.
+ */
+class ColumnarResult
+{
+public:
+    /*!
+     * \brief The ColumnType enum
+     * tells which typed vector holds the column
+     */
+    enum ColumnType
+    {
+        Integer, // integers()  -- signed integer types and 32-bit unsigned ones
+        Real,    // reals()     -- floating point
+        Boolean, // booleans()
+        Text,    // texts()
+        Other    // variants()  -- dates, binary, 64-bit unsigned and everything else
+    };
+
+    ColumnarResult();
+
+    /*!
+     * \brief rowCount  -- number of rows
+     * \return          -- returns as supposed
+     */
+    int rowCount() const;
+
+    /*!
+     * \brief columnCount   -- number of columns
+     * \return              -- returns as supposed
+     */
+    int columnCount() const;
+
+    /*!
+     * \brief columnNames   -- names of the columns, same as the keys of Selector::perform() maps
+     * \return              -- the shared header
+     */
+    QStringList columnNames() const;
+
+    /*!
+     * \brief columnIndex   -- finds the column by name
+     * \param name          -- column name or alias
+     * \return              -- index of the column, -1 if there is no such column
+     */
+    int columnIndex(const QString& name) const;
+
+    /*!
+     * \brief columnType    -- type of the column's storage
+     * \param column        -- column index
+     * \return              -- which of the typed accessors to use
+     */
+    ColumnType columnType(int column) const;
+
+    /*!
+     * \brief nulls     -- null bitmap of the column, a set bit means NULL in that row
+     * \param column    -- column index
+     * \return          -- bitmap of rowCount() bits
+     */
+    const QBitArray& nulls(int column) const;
+
+    const QVector<qint64>&      integers(int column) const;
+    const QVector<double>&      reals(int column) const;
+    const QVector<bool>&        booleans(int column) const;
+    const QVector<QString>&     texts(int column) const;
+    const QVector<QVariant>&    variants(int column) const;
+
+    /*!
+     * \brief isNull    -- checks a cell for NULL
+     * \param row       -- row index
+     * \param column    -- column index
+     * \return          -- if the value is NULL
+     */
+    bool isNull(int row, int column) const;
+
+    /*!
+     * \brief value     -- single cell access, slow way, for convenience
+     * \param row       -- row index
+     * \param column    -- column index
+     * \return          -- the value, null QVariant for NULL
+     */
+    QVariant value(int row, int column) const;
+
+    /*!
+     * \brief row       -- single row access, slow way, for convenience
+     * \param row       -- row index
+     * \return          -- map like Selector::perform() returns for that row
+     */
+    QVariantMap row(int row) const;
+
+private:
+    friend class Selector;
+
+    // the result of the query is read into the columns, sets the header on first call
+    void setColumns(const QSqlRecord& record);
+    void appendRow(const QSqlQuery& q);
+    void squeeze();
+
+    struct Column
+    {
+        ColumnType          m_type;
+        QBitArray           m_nulls;
+
+        QVector<qint64>     m_integers;
+        QVector<double>     m_reals;
+        QVector<bool>       m_booleans;
+        QVector<QString>    m_texts;
+        QVector<QVariant>   m_variants;
+    };
+
+    int                     m_rowCount;
+    QStringList             m_names;
+    QHash<QString, int>     m_index;
+    QVector<Column>         m_columns;
+};
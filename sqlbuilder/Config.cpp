@@ -1,7 +1,25 @@
 #include "Config.h"
 
+#include <QThread>
+
 QString Config::DRIVER {};
 QString Config::DBNAME {};
 QString Config::HOSTNAME {};
 QString Config::USERNAME {};
 QString Config::PASSWORD {};
+
+int Config::POOL_SIZE { QThread::idealThreadCount() };
+int Config::POOL_WAIT_MSECS { 30000 };
+int Config::POOL_IDLE_MSECS { 300000 };
+
+int Config::SCHEMA_CACHE_TTL_MSECS { 0 };
+int Config::STATEMENT_CACHE_SIZE { 64 };
+int Config::ASYNC_THREADS { QThread::idealThreadCount() };
+int Config::CURSOR_CHUNK_SIZE { 1000 };
+int Config::RESULT_CACHE_SIZE { 256 };
+int Config::IN_ARRAY_THRESHOLD { 100 };
+int Config::INSERT_CHUNK_VALUES { 32766 }; // SQLite's limit since 3.32, PostgreSQL allows 65535
+
+int Config::SLOW_LOG_MAX_BYTES { 10 * 1024 * 1024 };
+int Config::SLOW_LOG_MAX_FILES { 5 };
+int Config::SLOW_LOG_MAX_PENDING { 16 };
@@ -30,9 +30,39 @@ struct Config
         Config::PASSWORD = password;
     }
 
+    /*!
+     * \brief setPoolParams     -- convenience method, sets connection pool params at once (see ConnectionPool)
+     * \param maxConnections    -- maximum number of connections, kept by the pool
+     * \param waitMsecs         -- how long Query construction may wait for a free connection, when the pool is full
+     * \param idleMsecs         -- unused connections are closed after that timeout by their threads' event loops
+     * (threads without a running one close them on the next Query), 0 keeps them open forever
+     */
+    static void setPoolParams(int maxConnections, int waitMsecs, int idleMsecs = POOL_IDLE_MSECS)
+    {
+        Config::POOL_SIZE       = maxConnections;
+        Config::POOL_WAIT_MSECS = waitMsecs;
+        Config::POOL_IDLE_MSECS = idleMsecs;
+    }
+
     static QString DRIVER;
     static QString DBNAME;
     static QString HOSTNAME;
     static QString USERNAME;
     static QString PASSWORD;
+
+    static int     POOL_SIZE;
+    static int     POOL_WAIT_MSECS;
+    static int     POOL_IDLE_MSECS;
+
+    static int     SCHEMA_CACHE_TTL_MSECS; // 0 means cached table metadata never expires
+    static int     STATEMENT_CACHE_SIZE;   // prepared statements kept per connection
+    static int     ASYNC_THREADS;          // threads running performAsync(), read once on first use, kept below POOL_SIZE
+    static int     CURSOR_CHUNK_SIZE;      // default rows per FETCH of Selector::cursor()
+    static int     RESULT_CACHE_SIZE;      // results kept by ResultCache, 0 disables it
+    static int     IN_ARRAY_THRESHOLD;     // IN/NOT_IN lists that long are bound as one array on PostgreSQL
+    static int     INSERT_CHUNK_VALUES;    // bound values per INSERT statement, bigger inserts are split into chunks
+
+    static int     SLOW_LOG_MAX_BYTES;     // slow query log file is rotated when it grows that big
+    static int     SLOW_LOG_MAX_FILES;     // rotated slow query log files kept
+    static int     SLOW_LOG_MAX_PENDING;   // slow statements waiting for EXPLAIN, the others are logged without a plan
 };
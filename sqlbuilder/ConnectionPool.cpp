@@ -0,0 +1,274 @@
+#include "ConnectionPool.h"
+#include "StatementCache.h"
+#include "Config.h"
+
+#include <QSqlDatabase>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QThread>
+#include <QThreadStorage>
+#include <QTimer>
+#include <QUuid>
+
+namespace
+{
+
+struct PooledConnection
+{
+    QString             m_name;
+    QPointer<QThread>   m_owner;
+    int                 m_leases;
+    QElapsedTimer       m_idle;
+    bool                m_retired;  // given up for another thread, the owner closes it on return
+    QPointer<QObject>   m_context;  // lives on the owner thread, it's event loop runs the expiry checks
+    bool                m_expiryScheduled;
+
+    std::shared_ptr<StatementCache> m_statements;
+};
+
+QMutex                  POOL_MUTEX;
+QWaitCondition          POOL_RELEASED;
+QList<PooledConnection> POOL;
+int                     POOL_WAITERS { 0 };
+
+// finished threads are not notified about, so the waiters check the pool this often
+const int               POOL_RECHECK_MSECS { 100 };
+
+// receivers of the expiry checks, one per thread, deleted when the thread finishes
+QThreadStorage<QObject*> POOL_CONTEXTS;
+
+QObject* threadContext()
+{
+    if (!POOL_CONTEXTS.hasLocalData())
+        POOL_CONTEXTS.setLocalData(new QObject);
+
+    return POOL_CONTEXTS.localData();
+}
+
+bool ownerFinished(const PooledConnection& connection)
+{
+    return connection.m_owner.isNull() || connection.m_owner->isFinished();
+}
+
+// Qt connections may be closed only by the thread, that created them, or when it has finished
+bool removable(const PooledConnection& connection)
+{
+    return connection.m_owner == QThread::currentThread() || ownerFinished(connection);
+}
+
+// POOL_MUTEX should be locked, the connection must be removable()
+void removeConnection(int index)
+{
+    const PooledConnection connection = POOL.takeAt(index);
+    connection.m_statements->clear();
+
+    const QString& name = connection.m_name;
+    if (QSqlDatabase::contains(name))
+    {
+        QSqlDatabase::database(name, false).close();
+        QSqlDatabase::removeDatabase(name);
+    }
+
+    POOL_RELEASED.wakeAll();
+}
+
+void checkExpiry(const QString& name, bool idleTimer);
+
+// POOL_MUTEX should be locked, called by the owner thread: it's event loop checks the idle connection
+// after the delay (threads without a running event loop drop it on their next acquire())
+void scheduleExpiry(PooledConnection& connection, int msecs)
+{
+    if (connection.m_expiryScheduled || connection.m_context.isNull() || !QThread::currentThread()->eventDispatcher())
+        return;
+
+    connection.m_expiryScheduled = true;
+    const QString name = connection.m_name;
+    QTimer::singleShot(msecs, connection.m_context.data(), [name]{ checkExpiry(name, true); });
+}
+
+// runs on the owner thread, closes the connection if it's retired or has been idle for too long
+void checkExpiry(const QString& name, bool idleTimer)
+{
+    QMutexLocker locker(&POOL_MUTEX);
+    for (int i = 0; i < POOL.count(); ++i)
+    {
+        PooledConnection& connection = POOL[i];
+        if (connection.m_name != name)
+            continue;
+
+        if (idleTimer)
+            connection.m_expiryScheduled = false;
+
+        // leased again, release() schedules the next check
+        if (connection.m_leases > 0)
+            return;
+
+        const qint64 timeLeft = Config::POOL_IDLE_MSECS > 0 ? Config::POOL_IDLE_MSECS - connection.m_idle.elapsed() : 0;
+        if (connection.m_retired || (Config::POOL_IDLE_MSECS > 0 && timeLeft <= 0))
+            removeConnection(i);
+        else if (Config::POOL_IDLE_MSECS > 0)
+            scheduleExpiry(connection, int(timeLeft));
+        return;
+    }
+}
+
+// POOL_MUTEX should be locked, the connection is given up: the owner's event loop (if it has a running one)
+// closes it right away, otherwise the owner does on return
+void retire(PooledConnection& connection)
+{
+    connection.m_retired = true;
+
+    const QString name = connection.m_name;
+    if (!ownerFinished(connection) && !connection.m_context.isNull())
+        QTimer::singleShot(0, connection.m_context.data(), [name]{ checkExpiry(name, false); });
+}
+
+// POOL_MUTEX should be locked
+void removeStaleConnections()
+{
+    for (int i = POOL.count() - 1; i >= 0; --i)
+    {
+        const PooledConnection& connection = POOL[i];
+        if (ownerFinished(connection))
+            removeConnection(i);
+        else if (connection.m_leases == 0 && removable(connection)
+                 && (connection.m_retired
+                     || (Config::POOL_IDLE_MSECS > 0 && connection.m_idle.hasExpired(Config::POOL_IDLE_MSECS))))
+            removeConnection(i);
+    }
+}
+
+}
+
+/***************************************************************************************/
+
+QSqlDatabase ConnectionPool::acquire()
+{
+    QThread* const currentThread = QThread::currentThread();
+
+    QElapsedTimer waitTimer;
+    waitTimer.start();
+
+    QMutexLocker locker(&POOL_MUTEX);
+    forever
+    {
+        removeStaleConnections();
+
+        for (PooledConnection& connection : POOL)
+        {
+            if (connection.m_owner == currentThread && !connection.m_retired)
+            {
+                ++connection.m_leases;
+                return QSqlDatabase::database(connection.m_name, false);
+            }
+        }
+
+        if (POOL.count() >= qMax(1, Config::POOL_SIZE))
+        {
+            // the pool is full, so an idle connection of some other thread is given up,
+            // it's owner closes it on return, until then the waiting goes on
+            for (PooledConnection& connection : POOL)
+            {
+                if (connection.m_leases == 0 && !connection.m_retired)
+                {
+                    retire(connection);
+                    break;
+                }
+            }
+        }
+
+        if (POOL.count() < qMax(1, Config::POOL_SIZE))
+            break;
+
+        const qint64 timeLeft = Config::POOL_WAIT_MSECS - waitTimer.elapsed();
+        if (timeLeft <= 0)
+            throw std::runtime_error("No database connection available in the pool! =(");
+
+        ++POOL_WAITERS;
+        POOL_RELEASED.wait(&POOL_MUTEX, static_cast<unsigned long>(qMin<qint64>(timeLeft, POOL_RECHECK_MSECS)));
+        --POOL_WAITERS;
+    }
+
+    PooledConnection connection;
+    connection.m_name   = QString("sqlbuilder_%1").arg(QUuid::createUuid().toString());
+    connection.m_owner  = currentThread;
+    connection.m_leases = 1;
+    connection.m_retired = false;
+    connection.m_context = threadContext();
+    connection.m_expiryScheduled = false;
+    connection.m_statements = std::make_shared<StatementCache>(Config::STATEMENT_CACHE_SIZE);
+    POOL.append(connection);
+
+    QSqlDatabase db = QSqlDatabase::addDatabase(Config::DRIVER, connection.m_name);
+    db.setDatabaseName(Config::DBNAME);
+    db.setHostName(Config::HOSTNAME);
+    db.setUserName(Config::USERNAME);
+    db.setPassword(Config::PASSWORD);
+
+    return db;
+}
+
+void ConnectionPool::release(const QString& connectionName)
+{
+    QMutexLocker locker(&POOL_MUTEX);
+    for (int i = 0; i < POOL.count(); ++i)
+    {
+        PooledConnection& connection = POOL[i];
+        if (connection.m_name == connectionName)
+        {
+            if (--connection.m_leases == 0)
+            {
+                connection.m_idle.start();
+
+                // somebody waits for a place in the pool, the owner gives it up right here, on it's own thread
+                if ((POOL_WAITERS > 0 || connection.m_retired) && removable(connection))
+                {
+                    removeConnection(i);
+                }
+                else
+                {
+                    if (Config::POOL_IDLE_MSECS > 0 && connection.m_owner == QThread::currentThread())
+                        scheduleExpiry(connection, Config::POOL_IDLE_MSECS);
+                    POOL_RELEASED.wakeAll();
+                }
+            }
+            break;
+        }
+    }
+}
+
+std::shared_ptr<StatementCache> ConnectionPool::statementCache(const QString& connectionName)
+{
+    QMutexLocker locker(&POOL_MUTEX);
+    for (const PooledConnection& connection : POOL)
+    {
+        if (connection.m_name == connectionName)
+            return connection.m_statements;
+    }
+
+    return nullptr;
+}
+
+int ConnectionPool::size()
+{
+    QMutexLocker locker(&POOL_MUTEX);
+    return POOL.count();
+}
+
+void ConnectionPool::clear()
+{
+    QMutexLocker locker(&POOL_MUTEX);
+    for (int i = POOL.count() - 1; i >= 0; --i)
+    {
+        if (POOL[i].m_leases > 0)
+            continue;
+
+        if (removable(POOL[i]))
+            removeConnection(i);
+        else
+            retire(POOL[i]);
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <QString>
+
+QT_FORWARD_DECLARE_CLASS(QSqlDatabase)
+QT_FORWARD_DECLARE_CLASS(StatementCache)
+
+/*!
+ * \brief The ConnectionPool class
+ * keeps the database connections, that are shared by Query instances.
+ * QSqlDatabase connections can only be used from within the thread that created them,
+ * so every connection here is owned by a thread: all the Query objects of one thread
+ * share that thread's connection (exactly like they used to share the only one before),
+ * while different threads get different connections and do not serialize each other.
+ * Connections are created from the Config params on demand, the total amount is limited
+ * by Config::POOL_SIZE. A connection is closed only by it's own thread or after that thread
+ * has finished, as Qt requires. So when the pool is full, acquire() waits for a place for
+ * Config::POOL_WAIT_MSECS at most: threads, that release their last lease meanwhile, close
+ * their connections, an idle connection of another thread is given up and closed by it's owner's
+ * event loop or, if the owner has no running one, on return. Connections of finished threads are dropped.
+ * Connections stay open between Query lifetimes, they are opened lazily by the first Query
+ * that really needs them and closed when left idle for Config::POOL_IDLE_MSECS: by the owner's
+ * event loop, threads without a running one close it on their next Query instead (and reconnect).
+ * The class is used internally by Query, you don't need to call it manually, except for clear().
+ */
+class ConnectionPool
+{
+public:
+    /*!
+     * \brief acquire   -- leases the connection of the calling thread, creating it if needed.
+     * Throws std::runtime_error if no connection became available in Config::POOL_WAIT_MSECS.
+     * Every successful call should be paired with release()
+     * \return          -- connection, configured with the Config params (not necessarily opened)
+     */
+    static QSqlDatabase acquire();
+
+    /*!
+     * \brief release           -- returns the leased connection to the pool
+     * \param connectionName    -- name of the connection, returned by acquire()
+     */
+    static void release(const QString& connectionName);
+
+    /*!
+     * \brief statementCache    -- prepared statements' cache of the connection (see StatementCache),
+     * is dropped together with the connection, so use it only while holding the lease
+     * \param connectionName    -- name of the connection, returned by acquire()
+     * \return                  -- the cache or nullptr if there is no such connection in the pool
+     */
+    static std::shared_ptr<StatementCache> statementCache(const QString& connectionName);
+
+    /*!
+     * \brief size  -- number of connections, currently kept by the pool
+     * \return      -- leased and idle connections count
+     */
+    static int size();
+
+    /*!
+     * \brief clear -- closes and removes all the idle connections of the calling thread and of finished ones,
+     * the idle connections of other threads are closed by them on return (for example after changing
+     * connection params in Config)
+     */
+    static void clear();
+};
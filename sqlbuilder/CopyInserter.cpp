@@ -0,0 +1,437 @@
+#include "CopyInserter.h"
+#include "Query.h"
+#include "Config.h"
+#include "MultiRowInsert.h"
+#include "PgNative.h"
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDateTime>
+#include <QElapsedTimer>
+
+#include <atomic>
+
+#ifdef SQLBUILDER_LIBPQ
+#include <libpq-fe.h>
+#endif
+
+namespace
+{
+// a value in COPY text format: \N for NULL, backslash escapes for the separators
+void appendCopyValue(QByteArray& line, const QVariant& value)
+{
+    if (value.isNull())
+    {
+        line += "\\N";
+        return;
+    }
+
+    switch (value.type())
+    {
+    case QVariant::Bool:
+        line += value.toBool() ? 't' : 'f';
+        return;
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+        line += value.toString().toLatin1();
+        return;
+    case QVariant::Double:
+        line += QByteArray::number(value.toDouble(), 'g', 17);
+        return;
+    case QVariant::ByteArray:
+        line += "\\\\x"; // bytea hex format, it's backslash escaped
+        line += value.toByteArray().toHex();
+        return;
+    case QVariant::Date:
+        line += value.toDate().toString(Qt::ISODate).toLatin1();
+        return;
+    case QVariant::Time:
+        line += value.toTime().toString(Qt::ISODateWithMs).toLatin1();
+        return;
+    case QVariant::DateTime:
+        line += value.toDateTime().toString(Qt::ISODateWithMs).toLatin1();
+        return;
+    default:
+        break;
+    }
+
+    const QByteArray text = value.toString().toUtf8();
+    for (int i = 0; i < text.size(); ++i)
+    {
+        const char c = text.at(i);
+        switch (c)
+        {
+        case '\\': line += "\\\\"; break;
+        case '\t': line += "\\t";  break;
+        case '\n': line += "\\n";  break;
+        case '\r': line += "\\r";  break;
+        default:   line += c;
+        }
+    }
+}
+
+#ifdef SQLBUILDER_LIBPQ
+QSqlError nativeError(PGconn* conn, const PGresult* r = nullptr)
+{
+    if (r != nullptr)
+    {
+        return QSqlError(QString::fromUtf8(PQresultErrorMessage(r))
+                         , QString()
+                         , QSqlError::StatementError
+                         , QString::fromLatin1(PQresultErrorField(r, PG_DIAG_SQLSTATE)));
+    }
+
+    return QSqlError(QString::fromUtf8(PQerrorMessage(conn)), QString(), QSqlError::ConnectionError);
+}
+#endif
+}
+
+struct CopyInserter::CopyInserterPrivate
+{
+    CopyInserterPrivate(const Query* q, const QStringList& fields)
+        : m_query(q)
+        , m_fields(fields)
+        , m_returnKeys(false)
+        , m_state(IDLE)
+        , m_connection(nullptr)
+        , m_transaction(false)
+        , m_rowCount(0)
+    {}
+
+    enum State
+    {
+        IDLE,       // no rows yet
+        COPYING,    // COPY is in progress
+        INSERTING,  // fallback INSERTs are in progress
+        FINISHED,
+        FAILED
+    };
+
+    const Query*        m_query;
+    const QStringList   m_fields;
+    bool                m_returnKeys;
+
+    State               m_state;
+    void*               m_connection;   // PGconn* while copying
+    QString             m_copyTable;    // the target or the temporary table
+    bool                m_transaction;
+
+    QByteArray          m_buffer;       // COPY data not sent yet
+    QList<QVariantList> m_pending;      // rows of the next fallback INSERT
+
+    qint64              m_rowCount;
+    QList<int>          m_keys;
+
+    QueryStats          m_stats;
+    QElapsedTimer       m_timer;
+
+    // sends the collected rows by one multi-row INSERT, the fallback for non-COPY drivers
+    bool insertPending()
+    {
+        QVariantList bindValues;
+        const QString values = MultiRowInsert::valuesSQL(m_pending, bindValues);
+
+        const QString sql = CopyInserter::INSERT_SQL.arg(m_query->tableName()
+                                                         , m_fields.join(',')
+                                                         , values
+                                                         , m_query->primaryKeyName());
+
+        QSqlQuery q = m_query->execute(sql, bindValues, m_stats);
+        while (q.next())
+        {
+            if (m_returnKeys)
+                m_keys.append(q.value(0).toInt());
+        }
+        q.finish();
+
+        if (m_query->hasError())
+        {
+            fail(m_query->lastError());
+            return false;
+        }
+
+        m_rowCount += m_pending.count();
+        m_pending.clear();
+
+        return true;
+    }
+
+    // stops an unfinished load, nothing of it stays
+    void cancel()
+    {
+        if (m_state != COPYING && m_state != INSERTING)
+            return;
+
+#ifdef SQLBUILDER_LIBPQ
+        if (m_state == COPYING)
+        {
+            PGconn* conn = static_cast<PGconn*>(m_connection);
+            PQputCopyEnd(conn, "cancelled by the client");
+            while (PGresult* r = PQgetResult(conn))
+                PQclear(r);
+        }
+#endif
+
+        fail(m_query->lastError());
+    }
+
+    // ends the load with the error, the transaction is rolled back
+    void fail(const QSqlError& error)
+    {
+        m_state = FAILED;
+        m_buffer.clear();
+        m_pending.clear();
+
+        if (m_transaction)
+        {
+            m_transaction = false;
+            m_query->endTransaction(false);
+        }
+        m_query->setLastError(error);
+    }
+};
+
+/***************************************************************************************/
+
+const QString CopyInserter::COPY_SQL { "COPY %1 (%2) FROM STDIN;" };
+const QString CopyInserter::TEMP_TABLE_SQL { "CREATE TEMP TABLE %1 ON COMMIT DROP AS SELECT %2 FROM %3 WITH NO DATA;" };
+const QString CopyInserter::INSERT_SQL { "INSERT INTO %1 (%2) VALUES %3 RETURNING %4;" };
+const QString CopyInserter::MOVE_ROWS_SQL { "INSERT INTO %1 (%2) SELECT %2 FROM %3 ORDER BY ctid RETURNING %4;" };
+const int     CopyInserter::COPY_CHUNK_BYTES { 256 * 1024 };
+
+CopyInserter::CopyInserter(const Query* q, const QStringList& fields)
+    : impl(new CopyInserterPrivate(q, fields))
+{ }
+
+CopyInserter::~CopyInserter()
+{
+    if (impl)
+        impl->cancel();
+}
+
+CopyInserter::CopyInserter(CopyInserter &&) = default;
+
+CopyInserter& CopyInserter::operator=(CopyInserter&& other)
+{
+    // the replaced load is cancelled, as if the loader was destroyed
+    if (this != &other)
+    {
+        if (impl)
+            impl->cancel();
+        impl = std::move(other.impl);
+    }
+
+    return *this;
+}
+
+CopyInserter CopyInserter::returnKeys() &&
+{
+    impl->m_returnKeys = true;
+    return std::move(*this);
+}
+
+bool CopyInserter::add(const QVariantList& row)
+{
+    const Query* query = impl->m_query;
+
+    if (impl->m_state == CopyInserterPrivate::IDLE)
+    {
+        impl->m_timer.start();
+
+        const QSqlDatabase db = query->database();
+        if (!db.isOpen())
+        {
+            impl->fail(db.lastError());
+            return false;
+        }
+
+        impl->m_connection = db.driverName() == "QPSQL" ? PgNative::connection(db) : nullptr;
+
+        // COPY is atomic itself, the rest needs a transaction (joining the caller's one)
+        if (impl->m_returnKeys || impl->m_connection == nullptr)
+        {
+            if (!query->beginTransaction())
+            {
+                impl->fail(db.lastError());
+                return false;
+            }
+            impl->m_transaction = true;
+        }
+
+        impl->m_state = impl->m_connection != nullptr ? CopyInserterPrivate::COPYING : CopyInserterPrivate::INSERTING;
+        impl->m_copyTable = query->tableName();
+
+#ifdef SQLBUILDER_LIBPQ
+        if (impl->m_state == CopyInserterPrivate::COPYING)
+        {
+            if (impl->m_returnKeys)
+            {
+                static std::atomic<int> TABLE_COUNTER {0};
+                impl->m_copyTable = QString("sqlbuilder_copy_%1").arg(++TABLE_COUNTER);
+
+                query->executeRaw(CopyInserter::TEMP_TABLE_SQL.arg(impl->m_copyTable
+                                                                   , impl->m_fields.join(',')
+                                                                   , query->tableName()), impl->m_stats);
+                if (query->hasError())
+                {
+                    impl->fail(query->lastError());
+                    return false;
+                }
+            }
+
+            PGconn* conn = static_cast<PGconn*>(impl->m_connection);
+            const QString sql = CopyInserter::COPY_SQL.arg(impl->m_copyTable, impl->m_fields.join(','));
+
+            PGresult* r = PQexec(conn, sql.toUtf8().constData());
+            const bool started = PQresultStatus(r) == PGRES_COPY_IN;
+            const QSqlError error = started ? QSqlError() : nativeError(conn, r);
+            PQclear(r);
+
+            if (!started)
+            {
+                impl->fail(error);
+                return false;
+            }
+        }
+#endif
+    }
+
+    if (impl->m_state == CopyInserterPrivate::INSERTING)
+    {
+        impl->m_pending.append(row);
+
+        const int maxRows = qMax(1, Config::INSERT_CHUNK_VALUES / qMax(1, impl->m_fields.count()));
+        return impl->m_pending.count() < maxRows || impl->insertPending();
+    }
+
+    if (impl->m_state != CopyInserterPrivate::COPYING)
+        return false;
+
+    for (int i = 0; i < row.count(); ++i)
+    {
+        if (i > 0)
+            impl->m_buffer += '\t';
+        appendCopyValue(impl->m_buffer, row[i]);
+    }
+    impl->m_buffer += '\n';
+
+    if (impl->m_buffer.size() < CopyInserter::COPY_CHUNK_BYTES)
+        return true;
+
+#ifdef SQLBUILDER_LIBPQ
+    PGconn* conn = static_cast<PGconn*>(impl->m_connection);
+    if (PQputCopyData(conn, impl->m_buffer.constData(), impl->m_buffer.size()) != 1)
+    {
+        const QSqlError error = nativeError(conn);
+        PQputCopyEnd(conn, "cancelled by the client");
+        while (PGresult* r = PQgetResult(conn))
+            PQclear(r);
+
+        impl->fail(error);
+        return false;
+    }
+#endif
+    impl->m_buffer.clear();
+
+    return true;
+}
+
+qint64 CopyInserter::finish()
+{
+    const Query* query = impl->m_query;
+
+    switch (impl->m_state)
+    {
+    case CopyInserterPrivate::IDLE:
+        impl->m_state = CopyInserterPrivate::FINISHED;
+        return 0;
+    case CopyInserterPrivate::FINISHED:
+        return impl->m_rowCount;
+    case CopyInserterPrivate::FAILED:
+        return -1;
+    default:
+        break;
+    }
+
+    if (impl->m_state == CopyInserterPrivate::INSERTING && !impl->m_pending.isEmpty() && !impl->insertPending())
+        return -1;
+
+#ifdef SQLBUILDER_LIBPQ
+    if (impl->m_state == CopyInserterPrivate::COPYING)
+    {
+        PGconn* conn = static_cast<PGconn*>(impl->m_connection);
+
+        QSqlError error;
+        if (!impl->m_buffer.isEmpty() && PQputCopyData(conn, impl->m_buffer.constData(), impl->m_buffer.size()) != 1)
+            error = nativeError(conn);
+        impl->m_buffer.clear();
+
+        if (PQputCopyEnd(conn, error.isValid() ? "cancelled by the client" : nullptr) != 1 && !error.isValid())
+            error = nativeError(conn);
+
+        while (PGresult* r = PQgetResult(conn))
+        {
+            if (PQresultStatus(r) == PGRES_COMMAND_OK)
+                impl->m_rowCount = QByteArray(PQcmdTuples(r)).toLongLong();
+            else if (!error.isValid())
+                error = nativeError(conn, r);
+            PQclear(r);
+        }
+
+        if (error.isValid())
+        {
+            impl->fail(error);
+            return -1;
+        }
+
+        // the rows go from the temporary table, keeping their order
+        if (impl->m_returnKeys)
+        {
+            QSqlQuery q = query->executeRaw(CopyInserter::MOVE_ROWS_SQL.arg(query->tableName()
+                                                                           , impl->m_fields.join(',')
+                                                                           , impl->m_copyTable
+                                                                           , query->primaryKeyName()), impl->m_stats);
+            while (q.next())
+                impl->m_keys.append(q.value(0).toInt());
+            q.finish();
+
+            if (query->hasError())
+            {
+                impl->fail(query->lastError());
+                return -1;
+            }
+        }
+    }
+#endif
+
+    // one record for the whole load, whatever statements it took
+    impl->m_stats.m_sql = CopyInserter::COPY_SQL.arg(query->tableName(), impl->m_fields.join(','));
+    query->notifyWrite(query->tableName());
+
+    if (impl->m_transaction)
+    {
+        impl->m_transaction = false;
+        if (!query->endTransaction(true) && !Query::inTransaction())
+        {
+            impl->m_state = CopyInserterPrivate::FAILED;
+            query->setLastError(query->database().lastError());
+            return -1;
+        }
+    }
+
+    impl->m_state = CopyInserterPrivate::FINISHED;
+
+    impl->m_stats.m_executionNsecs = impl->m_timer.nsecsElapsed();
+    impl->m_stats.m_rowCount = impl->m_rowCount;
+    Query::reportStats(impl->m_stats);
+
+    return impl->m_rowCount;
+}
+
+QList<int> CopyInserter::keys() const
+{
+    return impl->m_keys;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <memory>
+#include <QVariant>
+#include <QStringList>
+
+QT_FORWARD_DECLARE_CLASS(Query)
+
+/*!
+ * \brief The CopyInserter class
+ * is a bulk loader for big amounts of rows, created by Query::copyIn(). Unlike the other generators
+ * it is not rvalue-only, the rows are added one at a time, as they come, and are not kept in memory:
+ * on PostgreSQL (when built with libpq) they are streamed by "COPY ... FROM STDIN" in the text format,
+ * in chunks, right through the Query's connection. Otherwise they are inserted by multi-row INSERTs of
+ * Config::INSERT_CHUNK_VALUES values, in one transaction. Either way the load is atomic, finish() makes it visible,
+ * destroying an unfinished loader cancels it. The Query must outlive the loader, don't perform
+ * other queries of the thread until finish(), the connection is busy.
+ */
+class CopyInserter
+{
+    Q_DISABLE_COPY(CopyInserter)
+public:
+    /*!
+     * \brief CopyInserter  -- constructor of the loader, don't use it manually
+     * \param q             -- ptr to the Query class, that created it
+     * \param fields        -- column names the rows' values go to
+     */
+    CopyInserter(const Query* q, const QStringList& fields);
+
+    /*!
+     * \brief ~CopyInserter -- cancels the load, if it was not finished
+     */
+    ~CopyInserter();
+
+    CopyInserter(CopyInserter&&);
+
+    /*!
+     * \brief operator= -- cancels the load of this loader, if it was not finished, and takes the other one
+     */
+    CopyInserter& operator=(CopyInserter&&);
+
+    /*!
+     * \brief returnKeys    -- makes finish() fetch the primary keys of the loaded rows (see keys()). With COPY the rows
+     * go through a temporary table then, and are moved by one "INSERT ... SELECT ... RETURNING", that costs some speed.
+     * Call it before adding rows
+     * \return              -- this loader as rvalue to be reused
+     */
+    CopyInserter returnKeys() &&;
+
+    /*!
+     * \brief add   -- adds a row, it is sent, when enough of them are collected
+     * \param row   -- values, shoul match by count the number of fields
+     * \return      -- false if the load has failed, check Query's lastError()
+     */
+    bool add(const QVariantList& row);
+
+    /*!
+     * \brief finish    -- sends the rest of the rows & ends the load
+     * \return          -- number of rows loaded, -1 on failure (see Query's lastError())
+     */
+    qint64 finish();
+
+    /*!
+     * \brief keys  -- primary keys of the loaded rows in order of adding, if returnKeys() was set
+     * \return      -- list of keys, empty before finish()
+     */
+    QList<int> keys() const;
+
+private:
+    struct CopyInserterPrivate;
+    std::unique_ptr<CopyInserterPrivate> impl;
+
+    static const QString COPY_SQL;
+    static const QString INSERT_SQL;
+    static const QString TEMP_TABLE_SQL;
+    static const QString MOVE_ROWS_SQL;
+
+    // COPY data is sent by chunks of that many bytes
+    static const int COPY_CHUNK_BYTES;
+};
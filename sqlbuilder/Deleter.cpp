@@ -1,18 +1,21 @@
 #include "Deleter.h"
 #include "Query.h"
+#include "AsyncRunner.h"
 
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QSqlDatabase>
+#include <QElapsedTimer>
 
 struct Deleter::DeleterPrivate
 {
     DeleterPrivate(const Query *q, OP::Clause&& whereClause)
         : m_query(q)
-        , m_where{std::move(whereClause).getSQl()}
+        , m_where(std::move(whereClause))
     {}
 
     const Query*        m_query;
-    QString             m_where;
+    OP::Clause          m_where;
 };
 
 const QString Deleter::DELETE_SQL { "DELETE FROM %1 WHERE %2;" };
@@ -30,10 +33,49 @@ Deleter::Deleter(Deleter &&) = default;
 
 bool Deleter::perform() &&
 {
-    const QString sql = Deleter::DELETE_SQL
-                    .arg(impl->m_query->tableName())
-                    .arg(impl->m_where.isEmpty() ? "True" : impl->m_where);
+    QueryStats stats;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVariantList bindValues;
+    const QString sql = buildSQL(bindValues);
+    stats.m_generationNsecs = timer.nsecsElapsed();
+
+    QSqlQuery q = impl->m_query->execute(sql, bindValues, stats);
+    impl->m_query->notifyWrite(tableName());
+    stats.m_rowCount = qMax(0, q.numRowsAffected());
+    q.finish();
+
+    Query::reportStats(stats);
+
+    return stats.m_rowCount > 0;
+}
+
+QFuture<bool> Deleter::performAsync() &&
+{
+    const Query* origin = impl->m_query;
+    std::shared_ptr<Deleter> deleter = std::make_shared<Deleter>(std::move(*this));
 
-    QSqlQuery q = impl->m_query->performSQL(sql);
-    return q.numRowsAffected() > 0;
+    return runAsync<bool>(*origin, [deleter](const Query& query) {
+        deleter->impl->m_query = &query;
+        return std::move(*deleter).perform();
+    });
+}
+
+QString Deleter::tableName() const
+{
+    return impl->m_query->tableName();
+}
+
+QString Deleter::buildSQL(QVariantList& bindValues) const
+{
+    const bool arrayParameters = impl->m_query->database().driverName() == "QPSQL";
+
+    bindValues.clear();
+    const QString where = impl->m_where.toSQL(bindValues, OP::Clause::ColumnResolver(), arrayParameters);
+
+    return Deleter::DELETE_SQL
+                    .arg(impl->m_query->tableName())
+                    .arg(where.isEmpty() ? "True" : where);
 }
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <QString>
+#include <QFuture>
 
 #include "Where.h"
 QT_FORWARD_DECLARE_CLASS(Query)
@@ -33,7 +34,23 @@ public:
      */
     bool perform() &&;
 
+    /*!
+     * \brief performAsync  -- executes the query on Query::asyncExecutor() thread pool, on that thread's own connection,
+     * so the caller is not blocked. The generator is consumed, the Query it was created by is not used anymore (it may be
+     * destroyed meanwhile), that also means the query is not a part of the caller's transaction.
+     * \return              -- future with success/failure of the query (affected rows > 0), it's result() throws QueryError on failure
+     */
+    QFuture<bool> performAsync() &&;
+
 private:
+    friend class Batch;
+
+    // generates the SQL with placeholders, filling the values to be bound
+    QString buildSQL(QVariantList& bindValues) const;
+
+    // the table being written, for cache invalidation
+    QString tableName() const;
+
     struct DeleterPrivate;
     std::unique_ptr<DeleterPrivate> impl;
 
@@ -1,26 +1,37 @@
 #include "Inserter.h"
 #include "Query.h"
-#include "Where.h"
+#include "Config.h"
+#include "MultiRowInsert.h"
+#include "AsyncRunner.h"
 
+#include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QElapsedTimer>
 
 struct Inserter::InserterPrivate
 {
     InserterPrivate(const Query* q, const QStringList& fields)
         : m_query(q)
         , m_fields(fields)
+        , m_chunkRows(0)
+        , m_singleTransaction(true)
     {}
 
     const Query*        m_query;
     const QStringList   m_fields;
 
     QList<QVariantList> m_data;
+    Inserter::RowSource m_source;
+
+    int                 m_chunkRows;    // 0 means derived from Config::INSERT_CHUNK_VALUES
+    bool                m_singleTransaction;
 };
 
 /***************************************************************************************/
 
 const QString Inserter::INSERT_SQL { "INSERT INTO %1 %2 VALUES %3 RETURNING %4;" };
+const QString Inserter::INSERT_BATCH_SQL { "INSERT INTO %1 (%2) VALUES (%3);" };
 
 Inserter::Inserter(const Query* q, const QStringList& fields)
     : impl(new InserterPrivate(q, fields))
@@ -36,6 +47,12 @@ InserterPerformer Inserter::values(const QVariantList& data) &&
     return InserterPerformer(std::move(*this)).values(data);
 }
 
+InserterPerformer Inserter::rows(RowSource source) &&
+{
+    impl->m_source = std::move(source);
+    return InserterPerformer(std::move(*this));
+}
+
 /***************************************************************************************/
 
 InserterPerformer::~InserterPerformer()
@@ -51,29 +68,176 @@ InserterPerformer InserterPerformer::values(const QVariantList& data) &&
     return std::move(*this);
 }
 
+InserterPerformer InserterPerformer::chunked(int rowsPerChunk, bool singleTransaction) &&
+{
+    impl->m_chunkRows = qMax(1, rowsPerChunk);
+    impl->m_singleTransaction = singleTransaction;
+    return std::move(*this);
+}
+
 QList<int> InserterPerformer::perform() &&
 {
-    QList<int> result;
+    const int chunkRows = impl->m_chunkRows > 0
+            ? impl->m_chunkRows
+            : qMax(1, Config::INSERT_CHUNK_VALUES / qMax(1, impl->m_fields.count()));
+
+    return MultiRowInsert::perform(impl->m_query, chunkRows, impl->m_singleTransaction
+                                   , [this, chunkRows]() { return takeRows(chunkRows); }
+                                   , [this](const QList<QVariantList>& rows, QVariantList& bindValues) {
+                                         return buildSQL(rows, bindValues);
+                                     });
+}
+
+bool InserterPerformer::performBatch() &&
+{
+    const Query* query = impl->m_query;
+
+    QStringList placeholders;
+    for (int i = 0; i < impl->m_fields.count(); ++i)
+        placeholders << "?";
+
+    const QString sql = Inserter::INSERT_BATCH_SQL
+                            .arg(query->tableName())
+                            .arg(impl->m_fields.join(','))
+                            .arg(placeholders.join(','));
+
+    const int chunkRows = impl->m_chunkRows > 0
+            ? impl->m_chunkRows
+            : qMax(1, Config::INSERT_CHUNK_VALUES / qMax(1, impl->m_fields.count()));
+
+    // drivers without array binding execute row by row, the transaction keeps the chunk (or all of them) atomic
+    bool transaction = false;
+    for (QList<QVariantList> chunk = takeRows(chunkRows); !chunk.isEmpty(); chunk = takeRows(chunkRows))
+    {
+        if (!transaction)
+        {
+            if (!query->beginTransaction())
+            {
+                query->setLastError(query->database().lastError());
+                return false;
+            }
+            transaction = true;
+        }
+
+        QueryStats stats;
+
+        QElapsedTimer timer;
+        timer.start();
+
+        // a row of another length would be padded with NULLs or cut, unlike an SQL error of perform()
+        QSqlError error;
+        for (const QVariantList& row : chunk)
+        {
+            if (row.count() != impl->m_fields.count())
+            {
+                error = QSqlError(QString("InserterPerformer: a row of %1 values for %2 fields")
+                                        .arg(row.count()).arg(impl->m_fields.count()), QString(), QSqlError::StatementError);
+                break;
+            }
+        }
+
+        if (!error.isValid())
+        {
+            QList<QVariantList> columns;
+            for (int i = 0; i < impl->m_fields.count(); ++i)
+            {
+                QVariantList column;
+                column.reserve(chunk.count());
+                for (const QVariantList& row : chunk)
+                    column << row[i];
+                columns << column;
+            }
+            stats.m_generationNsecs = timer.nsecsElapsed();
+
+            QSqlQuery q = query->executeBatch(sql, columns, stats);
+            query->notifyWrite(tableName());
+            q.finish();
+
+            stats.m_rowCount = chunk.count();
+            Query::reportStats(stats);
+
+            if (query->hasError())
+                error = query->lastError();
+        }
+
+        if (error.isValid())
+        {
+            query->endTransaction(false);
+            query->setLastError(error);
+            return false;
+        }
+
+        if (!impl->m_singleTransaction)
+        {
+            transaction = false;
+            if (!query->endTransaction(true))
+            {
+                query->setLastError(query->database().lastError());
+                return false;
+            }
+        }
+    }
+
+    if (transaction && !query->endTransaction(true))
+    {
+        query->setLastError(query->database().lastError());
+        return false;
+    }
+
+    return true;
+}
+
+QList<QVariantList> InserterPerformer::takeRows(int count)
+{
+    QList<QVariantList> rows;
 
-    QStringList valueTail;
-    for(const QVariantList& dataTuple : impl->m_data)
+    while (rows.count() < count && !impl->m_data.isEmpty())
+        rows.append(impl->m_data.takeFirst());
+
+    QVariantList row;
+    while (rows.count() < count && impl->m_source && impl->m_source(row))
     {
-        QStringList vBlock;
-        for(const QVariant& value : dataTuple)
-            vBlock << OP::Clause::escapeValue(value);
+        rows.append(row);
+        row.clear();
+    }
+
+    return rows;
+}
+
+QFuture<QList<int>> InserterPerformer::performAsync() &&
+{
+    const Query* origin = impl->m_query;
+    std::shared_ptr<InserterPerformer> performer = std::make_shared<InserterPerformer>(std::move(*this));
+
+    return runAsync<QList<int>>(*origin, [performer](const Query& query) {
+        performer->impl->m_query = &query;
+        return std::move(*performer).perform();
+    });
+}
 
-        valueTail << QString("(%1)").arg(vBlock.join(','));
+QString InserterPerformer::tableName() const
+{
+    return impl->m_query->tableName();
+}
+
+QString InserterPerformer::buildSQL(QVariantList& bindValues) const
+{
+    QVariantList row;
+    while (impl->m_source && impl->m_source(row))
+    {
+        impl->m_data.append(row);
+        row.clear();
     }
+    impl->m_source = nullptr;
 
-    const QString sql = Inserter::INSERT_SQL
+    return buildSQL(impl->m_data, bindValues);
+}
+
+QString InserterPerformer::buildSQL(const QList<QVariantList>& rows, QVariantList& bindValues) const
+{
+    return Inserter::INSERT_SQL
                     .arg(impl->m_query->tableName())
                     .arg(QString("(%1)").arg(impl->m_fields.join(',')))
-                    .arg(valueTail.join(','))
+                    .arg(MultiRowInsert::valuesSQL(rows, bindValues))
                     .arg(impl->m_query->primaryKeyName());
-
-    QSqlQuery q = impl->m_query->performSQL(sql);
-    while(q.next())
-        result.append(q.value(0).toInt());
-
-    return result;
 }
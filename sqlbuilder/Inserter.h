@@ -1,7 +1,9 @@
 #pragma once
 
 #include <memory>
+#include <functional>
 #include <QVariant>
+#include <QFuture>
 
 QT_FORWARD_DECLARE_CLASS(Query)
 QT_FORWARD_DECLARE_CLASS(InserterPerformer)
@@ -23,6 +25,11 @@ public:
     Inserter(const Query* q, const QStringList& fields);
     ~Inserter();
 
+    /*!
+     * \brief RowSource -- fills the next row to be inserted & returns true, returns false when there are no more rows
+     */
+    using RowSource = std::function<bool(QVariantList& row)>;
+
     Inserter(Inserter&&);
     Inserter& operator=(Inserter&&) = default;
 
@@ -33,12 +40,21 @@ public:
      */
     InserterPerformer values(const QVariantList& data) &&;
 
+    /*!
+     * \brief rows      -- makes the generator take the rows from the source while performing, chunk by chunk
+     * (see InserterPerformer::chunked()), so that they are never kept in memory all at once
+     * \param source    -- row source, called until it returns false
+     * \return          -- returns similar generator, but with the ability to execute the query
+     */
+    InserterPerformer rows(RowSource source) &&;
+
 private:
     struct InserterPrivate;
     std::unique_ptr<InserterPrivate> impl;
 
     friend class InserterPerformer;
     static const QString INSERT_SQL;
+    static const QString INSERT_BATCH_SQL;
 };
 
 /*******************************************************************************************/
@@ -75,12 +91,50 @@ public:
     InserterPerformer values(const QVariantList& data) &&;
 
     /*!
-     * \brief perform   -- executes the query
-     * \return          -- list of inserted records' ids  or empty list on failure,
+     * \brief chunked           -- sets how many rows go in one INSERT, by default it's as many as Config::INSERT_CHUNK_VALUES
+     * bound values allow. Bigger inserts are sent chunk by chunk, the values() rows first, then the source's ones
+     * \param rowsPerChunk      -- rows per statement
+     * \param singleTransaction -- all the chunks are inserted atomically, in one transaction (or the current one),
+     * otherwise each chunk is on it's own and the ones before a failure stay inserted
+     * \return                  -- returns this generator
+     */
+    InserterPerformer chunked(int rowsPerChunk, bool singleTransaction = true) &&;
+
+    /*!
+     * \brief perform   -- executes the query, one statement per chunk
+     * \return          -- list of inserted records' ids in order of the rows or empty list on failure,
      * also check Query's hasError() if you want to ensure the result
      */
     QList<int> perform() &&;
 
+    /*!
+     * \brief performAsync  -- executes the query on Query::asyncExecutor() thread pool, on that thread's own connection,
+     * so the caller is not blocked. The generator is consumed, the Query it was created by is not used anymore (it may be
+     * destroyed meanwhile), that also means the query is not a part of the caller's transaction.
+     * \return              -- future with list of inserted records' ids, it's result() throws QueryError on failure
+     */
+    QFuture<QList<int>> performAsync() &&;
+
+    /*!
+     * \brief performBatch  -- executes the query the other way: single-row INSERT is prepared once, the values are bound
+     * as column arrays and executed by QSqlQuery::execBatch(), drivers with array binding send all the rows in one call.
+     * Goes by chunks like perform(), in one transaction unless chunked() tells otherwise, then each chunk is atomic by itself
+     * \return              -- success/failure of the query (rows of a wrong length are a failure), ids are not returned
+     */
+    bool performBatch() &&;
+
 private:
+    friend class Batch;
+
+    // generates the SQL with placeholders, filling the values to be bound; drains the row source, one statement it is
+    QString buildSQL(QVariantList& bindValues) const;
+    QString buildSQL(const QList<QVariantList>& rows, QVariantList& bindValues) const;
+
+    // takes up to the count of rows: the ones added by values() first, then the source's
+    QList<QVariantList> takeRows(int count);
+
+    // the table being written, for cache invalidation
+    QString tableName() const;
+
     std::unique_ptr<Inserter::InserterPrivate> impl;
 };
@@ -0,0 +1,96 @@
+#include "MultiRowInsert.h"
+#include "Query.h"
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+
+QString MultiRowInsert::valuesSQL(const QList<QVariantList>& rows, QVariantList& bindValues)
+{
+    QStringList valueTail;
+    for(const QVariantList& dataTuple : rows)
+    {
+        QStringList vBlock;
+        for(const QVariant& value : dataTuple)
+        {
+            vBlock << "?";
+            bindValues << value;
+        }
+
+        valueTail << QString("(%1)").arg(vBlock.join(','));
+    }
+
+    return valueTail.join(',');
+}
+
+QList<int> MultiRowInsert::perform(const Query* query, int chunkRows, bool singleTransaction
+                                   , const ChunkSource& next, const StatementBuilder& build)
+{
+    QList<int> result;
+
+    bool transaction = false;
+    for (QList<QVariantList> chunk = next(); !chunk.isEmpty(); chunk = next())
+    {
+        // a full chunk means more may follow, a single statement is atomic anyway
+        if (singleTransaction && !transaction && chunk.count() == chunkRows)
+        {
+            if (!query->beginTransaction())
+            {
+                query->setLastError(query->database().lastError());
+                return QList<int>();
+            }
+            transaction = true;
+        }
+
+        if (!performChunk(query, chunk, build, result))
+        {
+            if (transaction)
+            {
+                const QSqlError error = query->lastError();
+                query->endTransaction(false);
+                query->setLastError(error);
+            }
+            return QList<int>();
+        }
+    }
+
+    if (transaction && !query->endTransaction(true))
+    {
+        query->setLastError(query->database().lastError());
+        return QList<int>();
+    }
+
+    return result;
+}
+
+bool MultiRowInsert::performChunk(const Query* query, const QList<QVariantList>& rows, const StatementBuilder& build, QList<int>& ids)
+{
+    QueryStats stats;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVariantList bindValues;
+    const QString sql = build(rows, bindValues);
+    stats.m_generationNsecs = timer.nsecsElapsed();
+
+    QSqlQuery q = query->execute(sql, bindValues, stats);
+    query->notifyWrite(query->tableName());
+
+    const qint64 mark = timer.nsecsElapsed();
+    int count = 0;
+    while(q.next())
+    {
+        ids.append(q.value(0).toInt());
+        ++count;
+    }
+    q.finish();
+
+    stats.m_fetchNsecs = timer.nsecsElapsed() - mark;
+    stats.m_rowCount = count;
+    stats.m_resultBytes = count * qint64(sizeof(int));
+    Query::reportStats(stats);
+
+    return !query->hasError();
+}
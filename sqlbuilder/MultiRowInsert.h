@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <QVariant>
+
+QT_FORWARD_DECLARE_CLASS(Query)
+
+/*!
+ * \brief The MultiRowInsert class
+ * is the internal part of the multi-row INSERT generators (InserterPerformer, Upserter, CopyInserter's fallback):
+ * renders VALUES (?,?),(?,?) and sends the rows chunk by chunk, collecting the ids of "... RETURNING pk".
+ */
+class MultiRowInsert
+{
+public:
+    /*!
+     * \brief ChunkSource   -- returns the next chunk of rows, an empty one when there are no more
+     */
+    using ChunkSource = std::function<QList<QVariantList>()>;
+
+    /*!
+     * \brief StatementBuilder  -- generates the statement for the rows with placeholders, filling the values to be bound
+     */
+    using StatementBuilder = std::function<QString(const QList<QVariantList>& rows, QVariantList& bindValues)>;
+
+    /*!
+     * \brief valuesSQL     -- renders the rows as placeholder tuples, like "(?,?),(?,?)"
+     * \param rows          -- rows of values
+     * \param bindValues    -- the values are appended to it, in order of the placeholders
+     * \return              -- VALUES part of the statement
+     */
+    static QString valuesSQL(const QList<QVariantList>& rows, QVariantList& bindValues);
+
+    /*!
+     * \brief perform           -- executes one statement per chunk. A full first chunk means more may follow, then
+     * all of them go in one transaction (or the current one), a single statement is atomic anyway
+     * \param query             -- Query of the table being written
+     * \param chunkRows         -- rows per chunk
+     * \param singleTransaction -- otherwise there's no transaction, the chunks before a failure stay inserted
+     * \param next              -- source of the chunks
+     * \param build             -- generator of the statements
+     * \return                  -- ids returned by the statements in order of the rows or empty list on failure,
+     * the error is set to the Query
+     */
+    static QList<int> perform(const Query* query, int chunkRows, bool singleTransaction
+                              , const ChunkSource& next, const StatementBuilder& build);
+
+private:
+    // executes the statement of one chunk, appends the returned ids
+    static bool performChunk(const Query* query, const QList<QVariantList>& rows, const StatementBuilder& build, QList<int>& ids);
+};
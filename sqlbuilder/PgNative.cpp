@@ -0,0 +1,101 @@
+#include "PgNative.h"
+
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QDateTime>
+
+#ifdef SQLBUILDER_LIBPQ
+#include <libpq-fe.h>
+#endif
+
+namespace PgNative
+{
+
+void* connection(const QSqlDatabase& db)
+{
+#ifdef SQLBUILDER_LIBPQ
+    if (!db.isOpen() || db.driver() == nullptr)
+        return nullptr;
+
+    const QVariant handle = db.driver()->handle();
+    if (handle.isValid() && qstrcmp(handle.typeName(), "PGconn*") == 0)
+        return *static_cast<PGconn* const*>(handle.constData());
+#else
+    Q_UNUSED(db)
+#endif
+    return nullptr;
+}
+
+QVariant value(const void* result, int row, int column)
+{
+#ifdef SQLBUILDER_LIBPQ
+    const PGresult* r = static_cast<const PGresult*>(result);
+
+    QVariant::Type type;
+    switch (PQftype(r, column))
+    {
+    case 16:   type = QVariant::Bool;      break; // bool
+    case 17:   type = QVariant::ByteArray; break; // bytea
+    case 20:   type = QVariant::LongLong;  break; // int8
+    case 21:                                      // int2
+    case 23:   type = QVariant::Int;       break; // int4
+    case 26:   type = QVariant::UInt;      break; // oid
+    case 700:                                     // float4
+    case 701:                                     // float8
+    case 1700: type = QVariant::Double;    break; // numeric
+    case 1082: type = QVariant::Date;      break; // date
+    case 1083: type = QVariant::Time;      break; // time
+    case 1114:                                    // timestamp
+    case 1184: type = QVariant::DateTime;  break; // timestamptz
+    default:   type = QVariant::String;
+    }
+
+    if (PQgetisnull(r, row, column))
+        return QVariant(type);
+
+    const char* text = PQgetvalue(r, row, column);
+    const QString str = QString::fromUtf8(text);
+
+    switch (type)
+    {
+    case QVariant::Bool:
+        return QVariant(text[0] == 't');
+    case QVariant::ByteArray:
+    {
+        size_t length = 0;
+        unsigned char* data = PQunescapeBytea(reinterpret_cast<const unsigned char*>(text), &length);
+        const QByteArray bytes(reinterpret_cast<const char*>(data), static_cast<int>(length));
+        PQfreemem(data);
+        return QVariant(bytes);
+    }
+    case QVariant::LongLong:
+        return QVariant(str.toLongLong());
+    case QVariant::Int:
+        return QVariant(str.toInt());
+    case QVariant::UInt:
+        return QVariant(str.toUInt());
+    case QVariant::Double:
+        return QVariant(str.toDouble());
+    case QVariant::Date:
+        return QVariant(QDate::fromString(str, Qt::ISODate));
+    case QVariant::Time:
+        return QVariant(QTime::fromString(str, Qt::ISODate));
+    case QVariant::DateTime:
+    {
+        QString isoDateTime = QString(str).replace(' ', 'T');
+        if (isoDateTime.length() > 3 && (isoDateTime.at(isoDateTime.length() - 3) == '+'
+                                         || isoDateTime.at(isoDateTime.length() - 3) == '-'))
+            isoDateTime += ":00"; // "+03" offset is not ISO enough for Qt
+
+        return QVariant(QDateTime::fromString(isoDateTime, Qt::ISODate));
+    }
+    default:
+        return QVariant(str);
+    }
+#else
+    Q_UNUSED(result) Q_UNUSED(row) Q_UNUSED(column)
+    return QVariant();
+#endif
+}
+
+} // namespace PgNative
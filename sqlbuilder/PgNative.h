@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QVariant>
+
+QT_FORWARD_DECLARE_CLASS(QSqlDatabase)
+
+/*!
+ * Internal helpers to reach libpq under the QPSQL driver, for the things Qt does not
+ * support (multiple result sets, COPY, etc.). Only available when the library is built
+ * with libpq (SQLBUILDER_LIBPQ is defined by the project file if pkg-config finds it),
+ * otherwise connection() always returns nullptr and callers fall back to plain Qt.
+ */
+namespace PgNative
+{
+
+/*!
+ * \brief connection    -- extracts native PGconn* from the QPSQL connection
+ * \param db            -- opened Qt connection
+ * \return              -- PGconn* as void* (so that libpq headers are not needed here) or nullptr
+ */
+void* connection(const QSqlDatabase& db);
+
+/*!
+ * \brief value -- converts a text-format value of PGresult to QVariant, similar to what QPSQL does
+ * \param result    -- PGresult* as void*
+ * \param row       -- row index
+ * \param column    -- column index
+ * \return          -- typed value, null QVariant of the proper type for NULLs
+ */
+QVariant value(const void* result, int row, int column);
+
+} // namespace PgNative
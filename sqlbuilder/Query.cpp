@@ -1,55 +1,99 @@
 #include "Query.h"
 
 #include "Config.h"
+#include "ConnectionPool.h"
+#include "SchemaCache.h"
+#include "StatementCache.h"
 #include "Selector.h"
 #include "Inserter.h"
+#include "Upserter.h"
 #include "Deleter.h"
 #include "Updater.h"
+#include "Batch.h"
+#include "CopyInserter.h"
+#include "SlowQueryLog.h"
+#include "ResultCache.h"
 
 #include <QSqlDatabase>
-#include <QSqlRecord>
 #include <QSqlQuery>
 #include <QSqlError>
-#include <QSqlIndex>
-#include <QUuid>
+#include <QThreadPool>
+#include <QElapsedTimer>
 
 #include <QDebug>
 
 struct Query::QueryPrivate
 {
     QueryPrivate(const QString& tableName, const QString& pkey)
-        : m_DB(Query::defaultConnection())
+        : m_DB(ConnectionPool::acquire())
+        , m_statements(ConnectionPool::statementCache(m_DB.connectionName()))
         , m_tableName(tableName)
     {
-        m_DB.setDatabaseName(Config::DBNAME);
-        m_DB.setHostName(Config::HOSTNAME);
-        m_DB.setUserName(Config::USERNAME);
-        m_DB.setPassword(Config::PASSWORD);
-
-        if (!m_DB.isOpen())
+        if (!m_tableName.isEmpty())
         {
-            if (!m_DB.open())
-                throw std::runtime_error("Database was not opened! =(");
+            SchemaCache::TableInfo info;
+            if (!SchemaCache::cachedTableInfo(m_tableName, info))
+            {
+                if (!openConnection())
+                {
+                    releaseConnection();
+                    throw std::runtime_error("Database was not opened! =(");
+                }
+                info = SchemaCache::tableInfo(m_DB, m_tableName);
+            }
+
+            m_pkey = info.m_primaryKey;
+            m_columnNames = info.m_columnNames;
         }
 
-        m_pkey = pkey.isEmpty() ? m_DB.primaryIndex(m_tableName).fieldName(0) : pkey;
+        if (!pkey.isEmpty())
+            m_pkey = pkey;
+    }
+
+    ~QueryPrivate()
+    {
+        releaseConnection();
+    }
+
+    // pooled connections are opened on first use and stay open between Query lifetimes
+    bool openConnection()
+    {
+        return m_DB.isOpen() || m_DB.open();
+    }
 
-        QSqlRecord columns = m_DB.record(m_tableName);
-        for(int i = 0; i < columns.count(); ++i)
-            m_columnNames << columns.fieldName(i);
+    // the handle should not outlive the lease, the pool may drop the connection afterwards
+    void releaseConnection()
+    {
+        const QString connectionName = m_DB.connectionName();
+        m_statements.reset();
+        m_DB = QSqlDatabase();
+        ConnectionPool::release(connectionName);
     }
 
-    QSqlDatabase            m_DB;
-    QString                 m_tableName;
+    QSqlDatabase                        m_DB;
+    std::shared_ptr<StatementCache>     m_statements;
+    QString                             m_tableName;
 
-    QString                 m_pkey;
-    QStringList             m_columnNames;
+    QString                             m_pkey;
+    QStringList                         m_columnNames;
+    QString                             m_tag;
 
-    QSqlError               m_lastError;
+    QSqlError                           m_lastError;
 };
 
 bool Query::LOG_QUERIES { false };
 
+namespace
+{
+// the connection is shared by the thread's Queries, so is it's transaction: nested ones join the outermost
+thread_local int    TRANSACTION_DEPTH  { 0 };
+thread_local bool   TRANSACTION_FAILED { false };
+
+// tables written in the current transaction, other threads may have cached them before the commit
+thread_local QStringList TRANSACTION_WRITES;
+}
+std::function<void(const QueryStats&)> Query::STATS_HANDLER;
+
 /**********************************************************************************/
 
 Query::Query(const QString& tableName, const QString& pkey)
@@ -57,9 +101,7 @@ Query::Query(const QString& tableName, const QString& pkey)
 { }
 
 Query::~Query()
-{
-    impl->m_DB.close();
-}
+{ }
 
 Query::Query(Query &&) = default;
 
@@ -68,18 +110,192 @@ void Query::setQueryLoggingEnabled(bool enabled)
     Query::LOG_QUERIES = enabled;
 }
 
+void Query::setStatsHandler(std::function<void(const QueryStats&)> handler)
+{
+    Query::STATS_HANDLER = std::move(handler);
+}
+
+bool Query::statsEnabled()
+{
+    return static_cast<bool>(Query::STATS_HANDLER);
+}
+
+void Query::reportStats(const QueryStats& stats)
+{
+    if (Query::STATS_HANDLER)
+        Query::STATS_HANDLER(stats);
+}
+
+void Query::setSlowQueryLogging(int thresholdMsecs, const QString& filePath)
+{
+    SlowQueryLog::setup(thresholdMsecs, filePath);
+}
+
+QThreadPool* Query::asyncExecutor()
+{
+    static QThreadPool executor;
+    static const bool configured = [] {
+        // each worker keeps a pooled connection, at least one place is left for the other threads
+        executor.setMaxThreadCount(qBound(1, Config::ASYNC_THREADS, Config::POOL_SIZE - 1));
+        // idle workers finish within half of the pool wait, their connections are dropped then
+        executor.setExpiryTimeout(qMax(1000, Config::POOL_WAIT_MSECS / 2));
+        return true;
+    }();
+    Q_UNUSED(configured)
+
+    return &executor;
+}
+
 QSqlQuery Query::performSQL(const QString& sql) const
 {
+    QueryStats stats;
+    QSqlQuery sqlQuery = executeRaw(sql, stats);
+
+    if (sqlQuery.isSelect())
+        stats.m_rowCount = sqlQuery.size() > 0 ? sqlQuery.size() : 0;
+    else
+        stats.m_rowCount = qMax(0, sqlQuery.numRowsAffected());
+    Query::reportStats(stats);
+
+    return sqlQuery;
+}
+
+QSqlQuery Query::performSQL(const QString& sql, const QVariantList& bindValues) const
+{
+    QueryStats stats;
+    QSqlQuery sqlQuery = execute(sql, bindValues, stats, false);
+
+    if (!sqlQuery.isSelect())
+        stats.m_rowCount = qMax(0, sqlQuery.numRowsAffected());
+    Query::reportStats(stats);
+
+    return sqlQuery;
+}
+
+QSqlQuery Query::executeRaw(const QString& sql, QueryStats& stats) const
+{
+    stats.m_sql = sql;
+
     QSqlQuery sqlQuery(impl->m_DB);
+    if (!impl->openConnection())
+    {
+        impl->m_lastError = impl->m_DB.lastError();
+        return sqlQuery;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
     sqlQuery.exec(sql);
 
+    const qint64 elapsed = timer.nsecsElapsed();
+    stats.m_executionNsecs += elapsed;
+
+    if (Query::LOG_QUERIES)
+        qDebug() << sqlQuery.lastQuery() << elapsed / 1000 << "us";
+
+    if (SlowQueryLog::isSlow(elapsed))
+        SlowQueryLog::record(impl->m_DB, sql, QVariantList(), impl->m_tag, elapsed);
+
+    impl->m_lastError = sqlQuery.lastError();
+    return sqlQuery;
+}
+
+QSqlQuery Query::execute(const QString& sql, const QVariantList& bindValues, QueryStats& stats, bool forwardOnly) const
+{
+    stats.m_sql = sql;
+
+    if (!impl->openConnection())
+    {
+        impl->m_lastError = impl->m_DB.lastError();
+        return QSqlQuery(impl->m_DB);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    bool prepared = false;
+    QSqlQuery sqlQuery = impl->m_statements->prepared(impl->m_DB, sql, prepared, forwardOnly);
+
+    if (prepared)
+    {
+        for (int i = 0; i < bindValues.count(); ++i)
+            sqlQuery.bindValue(i, bindValues[i]);
+
+        sqlQuery.exec();
+    }
+
+    const qint64 elapsed = timer.nsecsElapsed();
+    stats.m_executionNsecs += elapsed;
+
+    if (Query::LOG_QUERIES)
+        qDebug() << sqlQuery.lastQuery() << bindValues << elapsed / 1000 << "us";
+
+    if (SlowQueryLog::isSlow(elapsed))
+        SlowQueryLog::record(impl->m_DB, sql, bindValues, impl->m_tag, elapsed);
+
+    impl->m_lastError = sqlQuery.lastError();
+    return sqlQuery;
+}
+
+QSqlQuery Query::executeBatch(const QString& sql, const QList<QVariantList>& columns, QueryStats& stats) const
+{
+    stats.m_sql = sql;
+
+    if (!impl->openConnection())
+    {
+        impl->m_lastError = impl->m_DB.lastError();
+        return QSqlQuery(impl->m_DB);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    bool prepared = false;
+    QSqlQuery sqlQuery = impl->m_statements->prepared(impl->m_DB, sql, prepared);
+
+    QVariantList bindValues;
+    for (const QVariantList& column : columns)
+        bindValues.append(QVariant(column));
+
+    if (prepared)
+    {
+        for (int i = 0; i < bindValues.count(); ++i)
+            sqlQuery.bindValue(i, bindValues[i]);
+
+        sqlQuery.execBatch();
+    }
+
+    const qint64 elapsed = timer.nsecsElapsed();
+    stats.m_executionNsecs += elapsed;
+
     if (Query::LOG_QUERIES)
-        qDebug() << sqlQuery.lastQuery();
+        qDebug() << sqlQuery.lastQuery() << bindValues << elapsed / 1000 << "us";
+
+    // the plan is the same for all the rows, the first one is explained
+    if (SlowQueryLog::isSlow(elapsed))
+    {
+        QVariantList firstRow;
+        for (const QVariantList& column : columns)
+            firstRow << (column.isEmpty() ? QVariant() : column.first());
+        SlowQueryLog::record(impl->m_DB, sql, firstRow, impl->m_tag, elapsed);
+    }
 
     impl->m_lastError = sqlQuery.lastError();
     return sqlQuery;
 }
 
+QSqlDatabase Query::database() const
+{
+    impl->openConnection();
+    return impl->m_DB;
+}
+
+void Query::setLastError(const QSqlError& error) const
+{
+    impl->m_lastError = error;
+}
+
 QSqlError Query::lastError() const
 {
     return impl->m_lastError;
@@ -95,6 +311,16 @@ QString Query::tableName() const
     return impl->m_tableName;
 }
 
+void Query::setTag(const QString& tag)
+{
+    impl->m_tag = tag;
+}
+
+QString Query::tag() const
+{
+    return impl->m_tag;
+}
+
 QString Query::primaryKeyName() const
 {
     return impl->m_pkey;
@@ -107,13 +333,11 @@ QStringList Query::columnNames() const
 
 QStringList Query::tableColumnNames(const QString& tableName) const
 {
-    QStringList result;
-
-    QSqlRecord columns = impl->m_DB.record(tableName);
-    for(int i=0; i < columns.count(); ++i)
-        result << columns.fieldName(i);
+    SchemaCache::TableInfo info;
+    if (!SchemaCache::cachedTableInfo(tableName, info) && impl->openConnection())
+        info = SchemaCache::tableInfo(impl->m_DB, tableName);
 
-    return result;
+    return info.m_columnNames;
 }
 
 Selector Query::select(const QStringList& fields) const
@@ -126,6 +350,11 @@ Inserter Query::insert(const QStringList& fields) const
     return Inserter(this, fields);
 }
 
+Upserter Query::upsert(const QStringList& fields) const
+{
+    return Upserter(this, fields);
+}
+
 Deleter Query::delete_(OP::Clause&& whereClause) const
 {
     return Deleter(this, std::forward<OP::Clause>(whereClause));
@@ -136,30 +365,92 @@ Updater Query::update(const QVariantMap& updateValues) const
     return Updater(this, updateValues);
 }
 
-bool Query::transact(std::function<void ()>&& operations)
+UpdaterBatch Query::updateBatch(const QStringList& fields, const QString& keyField) const
+{
+    return UpdaterBatch(this, fields, keyField);
+}
+
+Batch Query::batch() const
+{
+    return Batch(this);
+}
+
+CopyInserter Query::copyIn(const QStringList& fields) const
+{
+    return CopyInserter(this, fields);
+}
+
+bool Query::transact(std::function<void ()>&& operations) const
 {
-    bool result;
+    if (!beginTransaction())
+        return false;
 
-    if (impl->m_DB.transaction())
+    try
     {
         std::move(operations)();
+    }
+    catch (...)
+    {
+        endTransaction(false);
+        throw;
+    }
 
-        if (hasError())
-        {
-            impl->m_DB.rollback();
-            result = false;
-        }
-        else
-            result = impl->m_DB.commit();
+    return endTransaction(!hasError());
+}
+
+bool Query::inTransaction()
+{
+    return TRANSACTION_DEPTH > 0;
+}
+
+void Query::notifyWrite(const QString& tableName) const
+{
+    ResultCache::invalidate(tableName);
+
+    if (TRANSACTION_DEPTH > 0)
+    {
+        if (!TRANSACTION_WRITES.contains(tableName))
+            TRANSACTION_WRITES.append(tableName);
     }
-    else
+}
+
+bool Query::beginTransaction() const
+{
+    if (TRANSACTION_DEPTH > 0)
+    {
+        ++TRANSACTION_DEPTH;
+        return true;
+    }
+
+    if (!impl->openConnection() || !impl->m_DB.transaction())
         return false;
 
-    return result;
+    TRANSACTION_DEPTH = 1;
+    TRANSACTION_FAILED = false;
+    return true;
 }
 
-QSqlDatabase& Query::defaultConnection()
+bool Query::endTransaction(bool success) const
 {
-    static QSqlDatabase dbInstance = QSqlDatabase::addDatabase(Config::DRIVER, QUuid::createUuid().toString());
-    return dbInstance;
+    if (!success)
+        TRANSACTION_FAILED = true;
+
+    if (--TRANSACTION_DEPTH > 0)
+        return success;
+
+    const bool commit = !TRANSACTION_FAILED;
+    TRANSACTION_FAILED = false;
+
+    bool result = false;
+    if (commit)
+        result = impl->m_DB.commit();
+    else
+        impl->m_DB.rollback();
+
+    for (const QString& table : TRANSACTION_WRITES)
+        ResultCache::invalidate(table);
+    TRANSACTION_WRITES.clear();
+
+    return result;
 }
+
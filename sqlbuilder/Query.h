@@ -5,15 +5,21 @@
 #include <QStringList>
 
 #include "Where.h"
+#include "QueryStats.h"
 
 QT_FORWARD_DECLARE_CLASS(QSqlDatabase)
 QT_FORWARD_DECLARE_CLASS(QSqlQuery)
 QT_FORWARD_DECLARE_CLASS(QSqlError)
+QT_FORWARD_DECLARE_CLASS(QThreadPool)
 
 QT_FORWARD_DECLARE_CLASS(Selector)
 QT_FORWARD_DECLARE_CLASS(Inserter)
+QT_FORWARD_DECLARE_CLASS(Upserter)
 QT_FORWARD_DECLARE_CLASS(Deleter)
 QT_FORWARD_DECLARE_CLASS(Updater)
+QT_FORWARD_DECLARE_CLASS(UpdaterBatch)
+QT_FORWARD_DECLARE_CLASS(Batch)
+QT_FORWARD_DECLARE_CLASS(CopyInserter)
 
 /*!
  * \brief The Query class
@@ -21,24 +27,26 @@ QT_FORWARD_DECLARE_CLASS(Updater)
  * Naming is not best perhaps, it shares a connection, performs SQL and 
  * provides access to all the other rvalue-only generators. They are rvalue-only,
  * because reusing them is undefined in terms of common sense, but you can reuse this Query class.
- * It is designed to be used somewhere locally when needed, opens/closes it's shared connection
- * on construction/destruction. Provides all the basics, CRUD + transactions. It is supposed
- * that all tables have primary key, not that it won't work without those, but the classes were
- * tesed on the data where they exist, use-case was the similar.
+ * It is designed to be used somewhere locally when needed, leases it's thread's connection
+ * from the ConnectionPool on construction and returns it on destruction. Provides all the basics,
+ * CRUD + transactions. It is supposed that all tables have primary key, not that it won't work
+ * without those, but the classes were tesed on the data where they exist, use-case was the similar.
  */
 class Query
 {
     Q_DISABLE_COPY(Query)
 public:
     /*!
-     * \brief Query     -- constructor, opens db connection, throws std::runtime_error if database was not opened
+     * \brief Query     -- constructor, leases db connection from the pool, throws std::runtime_error
+     * if no connection was available in time (see Config::setPoolParams()) or if database was not opened.
+     * The connection is opened lazily, only when some SQL is performed or table metadata is not cached yet
      * \param tableName -- name of the table to be used in the current set of queries 
      * \param pkey      -- primary key name, in case Qt will not be able to determine it
      */
     Query(const QString& tableName = QString(), const QString& pkey = QString());
 
     /*!
-     * \brief ~Query    -- note: the destructors closes the shared connection
+     * \brief ~Query    -- note: the destructor returns the shared connection to the pool
      */
     ~Query();
     
@@ -51,6 +59,32 @@ public:
      */
     static void setQueryLoggingEnabled(bool enabled);
 
+    /*!
+     * \brief setStatsHandler   -- globally sets a callback, receiving per-phase timings of every executed
+     * statement (see QueryStats). It is called on the thread, that performed the statement, including
+     * the threads of asyncExecutor(), so it must be thread-safe. Set it once at startup, empty disables it
+     * \param handler           -- the callback
+     */
+    static void setStatsHandler(std::function<void(const QueryStats&)> handler);
+
+    /*!
+     * \brief setSlowQueryLogging   -- globally enables the slow query log: statements, that run longer than
+     * the threshold, are written to a rotating file (see Config::SLOW_LOG_MAX_BYTES) with their bind values,
+     * the Query's tag and the plan, captured by EXPLAIN on a separate connection
+     * \param thresholdMsecs        -- latency threshold, 0 disables the log
+     * \param filePath              -- path of the log file
+     */
+    static void setSlowQueryLogging(int thresholdMsecs, const QString& filePath);
+
+    /*!
+     * \brief asyncExecutor -- thread pool, that runs generators' performAsync() calls,
+     * bounded by Config::ASYNC_THREADS and by Config::POOL_SIZE - 1 (both read on first use), so that the workers never take
+     * all the pooled connections. Each of it's threads has it's own pooled connection, a thread left idle for a half
+     * of Config::POOL_WAIT_MSECS finishes and it's connection is dropped.
+     * \return              -- the executor
+     */
+    static QThreadPool* asyncExecutor();
+
     /*!
      * \brief select    -- creates SELECT query generator
      * \param fields    -- column names in SELECT ... FROM
@@ -65,6 +99,13 @@ public:
      */
     Inserter insert(const QStringList& fields) const;
 
+    /*!
+     * \brief upsert    -- creates INSERT ... ON CONFLICT query generator
+     * \param fields    -- column names in INSERT INTO tbl (...)
+     * \return          -- upsert query generator
+     */
+    Upserter upsert(const QStringList& fields) const;
+
     /*!
      * \brief delete_       -- creates DELETE query generator
      * \param whereClause   -- "WHERE ..." clause (see OP namespace for details)
@@ -80,11 +121,35 @@ public:
     Updater  update(const QVariantMap& updateValues) const;
 
     /*!
-     * \brief transact      -- executes the given commands in a trancation
+     * \brief updateBatch   -- creates UPDATE generator for many rows of the same columns, the statement is prepared
+     * once and the values are bound as column arrays (see QSqlQuery::execBatch())
+     * \param fields        -- columns to be set, the key among them is not set but used to find the row
+     * \param keyField      -- column in "WHERE key = ?", usually the primary key
+     * \return              -- batch update generator
+     */
+    UpdaterBatch updateBatch(const QStringList& fields, const QString& keyField) const;
+
+    /*!
+     * \brief batch         -- creates a generator, that sends several queries in one round trip
+     * \return              -- batch generator, add other generators to it
+     */
+    Batch    batch() const;
+
+    /*!
+     * \brief copyIn        -- creates a bulk loader, that streams rows into the table (COPY ... FROM STDIN on PostgreSQL)
+     * \param fields        -- column names the rows' values go to
+     * \return              -- bulk loader, add rows to it & finish()
+     */
+    CopyInserter copyIn(const QStringList& fields) const;
+
+    /*!
+     * \brief transact      -- executes the given commands in a trancation. The connection is shared by all Queries
+     * of the thread, so transact() called inside another one (by any Query) joins the outer transaction: a failure
+     * rolls back the whole outer transaction, the commit happens when the outer one ends
      * \param operations    -- some callable, containing queries' execution
      * \return              -- success/failure of the transaction
      */
-    bool     transact(std::function<void()>&& operations);
+    bool     transact(std::function<void()>&& operations) const;
 
 public:
     /*!
@@ -95,6 +160,24 @@ public:
      */
     QSqlQuery performSQL(const QString& sql) const;
 
+    /*!
+     * \brief performSQL    -- performs SQL with positional "?" placeholders, binding the values to them.
+     * The statement is prepared once per connection and then reused from the cache (see StatementCache),
+     * like the generators execute their queries. Unlike theirs, the returned query is scrollable (seek(), size() work),
+     * call finish() on it when done reading, so that the cached statement can be reused right away.
+     * \param sql           -- string with SQL query to be executed
+     * \param bindValues    -- values for the placeholders, in order
+     * \return              -- Qt's query object with the state of the query
+     */
+    QSqlQuery performSQL(const QString& sql, const QVariantList& bindValues) const;
+
+    /*!
+     * \brief database  -- the connection this Query has leased, opened if possible.
+     * For things not covered by the library, don't keep it longer than the Query itself.
+     * \return          -- the connection
+     */
+    QSqlDatabase database() const;
+
     /*!
      * \brief lastError -- wrapper method for obtaining last error of the last query
      * \return          -- last QSqlQuery's lastError()
@@ -113,6 +196,18 @@ public:
      */
     QString tableName() const;
 
+    /*!
+     * \brief setTag    -- sets a caller-defined label, written to the slow query log with this Query's statements
+     * \param tag       -- some label, like the name of the endpoint
+     */
+    void setTag(const QString& tag);
+
+    /*!
+     * \brief tag       -- caller-defined label of this Query
+     * \return          -- the label
+     */
+    QString tag() const;
+
     /*!
      * \brief primaryKeyName -- name of the primary key column, set for the chosen table
      * \return               -- primary key column name
@@ -126,15 +221,45 @@ public:
     QStringList columnNames() const;
 
     /*!
-     * \brief tableColumnNames  -- helper method, can get a list of column's names for arbitrary existing table
+     * \brief tableColumnNames  -- helper method, can get a list of column's names for arbitrary existing table,
+     * the result is cached (see SchemaCache)
      * \param tableName         -- name of the table to be examined
      * \return                  -- returns as supposed
      */
     QStringList tableColumnNames(const QString& tableName) const;
 
 private:
-    static QSqlDatabase& defaultConnection();
+    friend class Selector;
+    friend class InserterPerformer;
+    friend class Upserter;
+    friend class Updater;
+    friend class UpdaterBatch;
+    friend class Deleter;
+    friend class Batch;
+    friend class StaticQueryRunner;
+    friend class CopyInserter;
+    friend class MultiRowInsert;
+
+    // performSQL() with binding, but the stats are passed on, so that the caller finishes and reports them
+    QSqlQuery execute(const QString& sql, const QVariantList& bindValues, QueryStats& stats, bool forwardOnly = true) const;
+    QSqlQuery executeRaw(const QString& sql, QueryStats& stats) const;
+    // the same, but the statement is executed for each row by execBatch(), values are bound as column arrays
+    QSqlQuery executeBatch(const QString& sql, const QList<QVariantList>& columns, QueryStats& stats) const;
+
+    // begins a transaction or joins the thread's current one; endTransaction() commits or rolls back the outermost one
+    bool beginTransaction() const;
+    bool endTransaction(bool success) const;
+    static bool inTransaction();
+
+    // invalidates the cached results of the table, once more when the current transaction ends
+    void notifyWrite(const QString& tableName) const;
+    void setLastError(const QSqlError& error) const;
+
+    static bool statsEnabled();
+    static void reportStats(const QueryStats& stats);
+
     static bool LOG_QUERIES;
+    static std::function<void(const QueryStats&)> STATS_HANDLER;
 
 private:
     struct QueryPrivate;
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QException>
+#include <QSqlError>
+
+/*!
+ * \brief The QueryError class
+ * is an exception, that delivers the error of an asynchronously performed query
+ * together with it's result: QFuture::result() rethrows it in the waiting thread.
+ * Synchronous queries do not throw it, check Query's lastError() for them as usually.
+ */
+class QueryError : public QException
+{
+public:
+    /*!
+     * \brief QueryError    -- constructor, obviously
+     * \param error         -- error, reported by the database or the connection
+     */
+    explicit QueryError(const QSqlError& error)
+        : m_error(error)
+        , m_what(error.text().toUtf8())
+    { }
+
+    /*!
+     * \brief error -- the error, the query has failed with
+     * \return      -- Qt's error object, same as Query's lastError() would be
+     */
+    QSqlError error() const
+    {
+        return m_error;
+    }
+
+    const char* what() const noexcept override
+    {
+        return m_what.constData();
+    }
+
+    void raise() const override
+    {
+        throw *this;
+    }
+
+    QueryError* clone() const override
+    {
+        return new QueryError(*this);
+    }
+
+private:
+    QSqlError   m_error;
+    QByteArray  m_what;
+};
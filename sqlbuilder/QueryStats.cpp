@@ -0,0 +1,25 @@
+#include "QueryStats.h"
+
+#include <QByteArray>
+
+qint64 QueryStats::approximateSize(const QVariant& value)
+{
+    if (value.isNull())
+        return 0;
+
+    switch (value.type())
+    {
+    case QVariant::String:
+        return value.toString().size() * qint64(sizeof(QChar));
+    case QVariant::ByteArray:
+        return value.toByteArray().size();
+    case QVariant::Bool:
+        return 1;
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::Date:
+        return 4;
+    default:
+        return 8;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QString>
+#include <QVariant>
+
+/*!
+ * \brief The QueryStats struct
+ * is a timing report of one executed statement, see Query::setStatsHandler().
+ * Phases, that were not a part of the statement's way (e.g. generation for raw
+ * performSQL() calls or materialization for UPDATE), are left zero.
+ */
+struct QueryStats
+{
+    QString m_sql;                          // statement text, with placeholders if any
+
+    qint64  m_generationNsecs       {0};    // building SQL in the generator
+    qint64  m_executionNsecs        {0};    // prepare + bind + exec, the round trip
+    qint64  m_fetchNsecs            {0};    // reading rows with next() and value()
+    qint64  m_materializationNsecs  {0};    // building the result containers
+
+    int     m_rowCount              {0};    // rows read, or affected for UPDATE/DELETE
+    qint64  m_resultBytes           {0};    // approximate size of the values read
+
+    /*!
+     * \brief approximateSize -- rough payload size of a value, not counting QVariant's own overhead
+     * \param value           -- value read from the database
+     * \return                -- size in bytes
+     */
+    static qint64 approximateSize(const QVariant& value);
+};
@@ -0,0 +1,145 @@
+#include "ResultCache.h"
+#include "Config.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+#include <QDataStream>
+
+#include <atomic>
+
+namespace
+{
+
+struct CacheEntry
+{
+    QVariantList    m_rows;
+    QStringList     m_tables;
+};
+
+QMutex                          CACHE_MUTEX;
+QHash<QByteArray, CacheEntry>   CACHE;
+QList<QByteArray>               USAGE_ORDER; // least recently used go first
+
+// invalidations per table & of the whole cache, they only grow, so their sum changes on any of them
+QHash<QString, quint64>         TABLE_GENERATIONS;
+quint64                         GLOBAL_GENERATION { 0 };
+
+quint64 currentGeneration(const QStringList& tables)
+{
+    quint64 result = GLOBAL_GENERATION;
+    for (const QString& table : tables)
+        result += TABLE_GENERATIONS.value(table);
+
+    return result;
+}
+
+std::atomic<quint64>            HITS   { 0 };
+std::atomic<quint64>            MISSES { 0 };
+
+}
+
+/***************************************************************************************/
+
+bool ResultCache::lookup(const QByteArray& key, QVariantList& rows)
+{
+    QMutexLocker locker(&CACHE_MUTEX);
+
+    auto it = CACHE.constFind(key);
+    if (it == CACHE.constEnd())
+    {
+        ++MISSES;
+        return false;
+    }
+
+    USAGE_ORDER.removeOne(key);
+    USAGE_ORDER.append(key);
+
+    rows = it->m_rows;
+    ++HITS;
+    return true;
+}
+
+void ResultCache::store(const QByteArray& key, const QStringList& tables, const QVariantList& rows, quint64 generation)
+{
+    if (Config::RESULT_CACHE_SIZE <= 0)
+        return;
+
+    QMutexLocker locker(&CACHE_MUTEX);
+
+    if (currentGeneration(tables) != generation)
+        return;
+
+    if (CACHE.contains(key))
+        USAGE_ORDER.removeOne(key);
+
+    while (!USAGE_ORDER.isEmpty() && CACHE.count() >= Config::RESULT_CACHE_SIZE)
+        CACHE.remove(USAGE_ORDER.takeFirst());
+
+    CACHE.insert(key, CacheEntry{rows, tables});
+    USAGE_ORDER.append(key);
+}
+
+QByteArray ResultCache::makeKey(const QString& sql, const QVariantList& bindValues)
+{
+    // the exact text with it's length (whitespace in literals matters), then the values with their types,
+    // so that 1 and "1" are different keys
+    QByteArray key;
+    QDataStream stream(&key, QIODevice::WriteOnly);
+    stream << sql << bindValues;
+
+    return key;
+}
+
+quint64 ResultCache::generation(const QStringList& tables)
+{
+    QMutexLocker locker(&CACHE_MUTEX);
+    return currentGeneration(tables);
+}
+
+void ResultCache::invalidate(const QString& tableName)
+{
+    QMutexLocker locker(&CACHE_MUTEX);
+    ++TABLE_GENERATIONS[tableName];
+
+    for (auto it = CACHE.begin(); it != CACHE.end(); )
+    {
+        if (it->m_tables.contains(tableName))
+        {
+            USAGE_ORDER.removeOne(it.key());
+            it = CACHE.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+void ResultCache::invalidateAll()
+{
+    QMutexLocker locker(&CACHE_MUTEX);
+    ++GLOBAL_GENERATION;
+    CACHE.clear();
+    USAGE_ORDER.clear();
+}
+
+quint64 ResultCache::hits()
+{
+    return HITS;
+}
+
+quint64 ResultCache::misses()
+{
+    return MISSES;
+}
+
+int ResultCache::size()
+{
+    QMutexLocker locker(&CACHE_MUTEX);
+    return CACHE.count();
+}
+
+void ResultCache::resetCounters()
+{
+    HITS = 0;
+    MISSES = 0;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <QStringList>
+#include <QVariant>
+
+/*!
+ * \brief The ResultCache class
+ * is a process-wide LRU cache of SELECT results, for reference tables that rarely change.
+ * It is opt-in, only Selector::cached() queries use it. Entries are keyed by the generated SQL
+ * together with it's bound values and remember the tables they were read from, including
+ * joined ones. The generators' writes (insert, update, delete, batches) invalidate the entries
+ * of their table, when in a transaction -- also on it's end. Writes done by raw SQL or by other
+ * processes are not seen, call invalidate() then. Bounded by Config::RESULT_CACHE_SIZE entries.
+ */
+class ResultCache
+{
+public:
+    /*!
+     * \brief lookup    -- finds the result, counts a hit or a miss
+     * \param key       -- key, made by makeKey()
+     * \param rows      -- receives the cached rows on hit
+     * \return          -- true on cache hit
+     */
+    static bool lookup(const QByteArray& key, QVariantList& rows);
+
+    /*!
+     * \brief store         -- puts the result to the cache, evicting the least recently used ones. The result is not
+     * stored, if the tables were invalidated since the generation was taken: it could be read before that write
+     * \param key           -- key, made by makeKey()
+     * \param tables        -- tables the result depends on
+     * \param rows          -- the result
+     * \param generation    -- generation() of the tables, taken before the result was read
+     */
+    static void store(const QByteArray& key, const QStringList& tables, const QVariantList& rows, quint64 generation);
+
+    /*!
+     * \brief generation    -- version of the tables' cached data, it changes on each invalidation of any of them
+     * \param tables        -- tables the result depends on
+     * \return              -- the version, to be passed to store()
+     */
+    static quint64 generation(const QStringList& tables);
+
+    /*!
+     * \brief makeKey       -- makes cache key of a statement
+     * \param sql           -- SQL with placeholders
+     * \param bindValues    -- values bound to it
+     * \return              -- the key
+     */
+    static QByteArray makeKey(const QString& sql, const QVariantList& bindValues);
+
+    /*!
+     * \brief invalidate    -- drops all the results, that depend on the table
+     * \param tableName     -- name of the changed table
+     */
+    static void invalidate(const QString& tableName);
+
+    /*!
+     * \brief invalidateAll -- drops the whole cache
+     */
+    static void invalidateAll();
+
+    /*!
+     * \brief hits  -- number of lookups, that found the result
+     * \return      -- counter value since the start (or resetCounters())
+     */
+    static quint64 hits();
+
+    /*!
+     * \brief misses    -- number of lookups, that did not find the result
+     * \return          -- counter value since the start (or resetCounters())
+     */
+    static quint64 misses();
+
+    /*!
+     * \brief size  -- number of cached results
+     * \return      -- returns as supposed
+     */
+    static int size();
+
+    /*!
+     * \brief resetCounters -- sets hits() and misses() to zero
+     */
+    static void resetCounters();
+};
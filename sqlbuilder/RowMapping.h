@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QSqlQuery>
+#include <QStringList>
+#include <QVector>
+
+/*!
+ * \brief The RowMapping struct
+ * binds a plain struct's fields to the columns of a SELECT at compile time, for Selector::perform<T>().
+ * Don't specialize it manually, use the SQLBUILDER_ROW macro at global namespace scope:
+ *
+ *     struct Item { int _id; QString name; QVariant descr; };
+ *     SQLBUILDER_ROW(Item, _id, name, descr)
+ *
+ * Field names are the column names (or aliases) of the result, up to 16 fields are supported.
+ * Values are converted with QVariant::value<F>(), NULL becomes a default value unless the field is a QVariant.
+ */
+template<typename T>
+struct RowMapping
+{
+    static_assert(sizeof(T) == 0, "Declare the row type with SQLBUILDER_ROW(Type, fields...) first");
+};
+
+namespace RowMappingDetail
+{
+    template<typename F>
+    inline void readValue(const QSqlQuery& q, int index, F& field)
+    {
+        if (index >= 0)
+            field = q.value(index).value<F>();
+    }
+
+    inline void readValue(const QSqlQuery& q, int index, QVariant& field)
+    {
+        if (index >= 0)
+            field = q.value(index);
+    }
+}
+
+// preprocessor "for each", the EXPAND indirection is needed by MSVC's __VA_ARGS__ handling
+#define SQLBUILDER_EXPAND(x) x
+#define SQLBUILDER_FE_1(m, x)       m(x)
+#define SQLBUILDER_FE_2(m, x, ...)  m(x) SQLBUILDER_EXPAND(SQLBUILDER_FE_1(m, __VA_ARGS__))
+#define SQLBUILDER_FE_3(m, x, ...)  m(x) SQLBUILDER_EXPAND(SQLBUILDER_FE_2(m, __VA_ARGS__))
+#define SQLBUILDER_FE_4(m, x, ...)  m(x) SQLBUILDER_EXPAND(SQLBUILDER_FE_3(m, __VA_ARGS__))
+#define SQLBUILDER_FE_5(m, x, ...)  m(x) SQLBUILDER_EXPAND(SQLBUILDER_FE_4(m, __VA_ARGS__))
+#define SQLBUILDER_FE_6(m, x, ...)  m(x) SQLBUILDER_EXPAND(SQLBUILDER_FE_5(m, __VA_ARGS__))
+#define SQLBUILDER_FE_7(m, x, ...)  m(x) SQLBUILDER_EXPAND(SQLBUILDER_FE_6(m, __VA_ARGS__))
+#define SQLBUILDER_FE_8(m, x, ...)  m(x) SQLBUILDER_EXPAND(SQLBUILDER_FE_7(m, __VA_ARGS__))
+#define SQLBUILDER_FE_9(m, x, ...)  m(x) SQLBUILDER_EXPAND(SQLBUILDER_FE_8(m, __VA_ARGS__))
+#define SQLBUILDER_FE_10(m, x, ...) m(x) SQLBUILDER_EXPAND(SQLBUILDER_FE_9(m, __VA_ARGS__))
+#define SQLBUILDER_FE_11(m, x, ...) m(x) SQLBUILDER_EXPAND(SQLBUILDER_FE_10(m, __VA_ARGS__))
+#define SQLBUILDER_FE_12(m, x, ...) m(x) SQLBUILDER_EXPAND(SQLBUILDER_FE_11(m, __VA_ARGS__))
+#define SQLBUILDER_FE_13(m, x, ...) m(x) SQLBUILDER_EXPAND(SQLBUILDER_FE_12(m, __VA_ARGS__))
+#define SQLBUILDER_FE_14(m, x, ...) m(x) SQLBUILDER_EXPAND(SQLBUILDER_FE_13(m, __VA_ARGS__))
+#define SQLBUILDER_FE_15(m, x, ...) m(x) SQLBUILDER_EXPAND(SQLBUILDER_FE_14(m, __VA_ARGS__))
+#define SQLBUILDER_FE_16(m, x, ...) m(x) SQLBUILDER_EXPAND(SQLBUILDER_FE_15(m, __VA_ARGS__))
+
+#define SQLBUILDER_FE_PICK(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, NAME, ...) NAME
+#define SQLBUILDER_FOR_EACH(m, ...) \
+    SQLBUILDER_EXPAND(SQLBUILDER_FE_PICK(__VA_ARGS__ \
+        , SQLBUILDER_FE_16, SQLBUILDER_FE_15, SQLBUILDER_FE_14, SQLBUILDER_FE_13 \
+        , SQLBUILDER_FE_12, SQLBUILDER_FE_11, SQLBUILDER_FE_10, SQLBUILDER_FE_9 \
+        , SQLBUILDER_FE_8, SQLBUILDER_FE_7, SQLBUILDER_FE_6, SQLBUILDER_FE_5 \
+        , SQLBUILDER_FE_4, SQLBUILDER_FE_3, SQLBUILDER_FE_2, SQLBUILDER_FE_1)(m, __VA_ARGS__))
+
+#define SQLBUILDER_ROW_COLUMN(field) QStringLiteral(#field),
+#define SQLBUILDER_ROW_READ(field) RowMappingDetail::readValue(q, indexes[index++], row.field);
+
+/*!
+ * \brief SQLBUILDER_ROW -- declares the RowMapping of a struct, see above
+ * \param Type           -- the struct
+ * \param ...            -- it's fields, named as the columns
+ */
+#define SQLBUILDER_ROW(Type, ...) \
+    template<> \
+    struct RowMapping<Type> \
+    { \
+        static QStringList columns() \
+        { \
+            return QStringList{ SQLBUILDER_EXPAND(SQLBUILDER_FOR_EACH(SQLBUILDER_ROW_COLUMN, __VA_ARGS__)) }; \
+        } \
+        static void read(const QSqlQuery& q, const QVector<int>& indexes, Type& row) \
+        { \
+            int index = 0; \
+            SQLBUILDER_EXPAND(SQLBUILDER_FOR_EACH(SQLBUILDER_ROW_READ, __VA_ARGS__)) \
+        } \
+    };
@@ -0,0 +1,96 @@
+#include "SchemaCache.h"
+#include "Config.h"
+
+#include <QSqlDatabase>
+#include <QSqlRecord>
+#include <QSqlIndex>
+#include <QReadWriteLock>
+#include <QElapsedTimer>
+#include <QHash>
+
+namespace
+{
+
+struct CacheEntry
+{
+    QString                 m_tableName;
+    SchemaCache::TableInfo  m_info;
+    QElapsedTimer           m_age;
+};
+
+QReadWriteLock                  CACHE_LOCK;
+QHash<QString, CacheEntry>      CACHE;
+
+// same named tables of different databases are different entries
+QString cacheKey(const QString& driver, const QString& hostName, const QString& dbName, const QString& tableName)
+{
+    return QStringList({driver, hostName, dbName, tableName}).join(QLatin1Char('\n'));
+}
+
+// the database the pooled connections are made for
+QString configuredKey(const QString& tableName)
+{
+    return cacheKey(Config::DRIVER, Config::HOSTNAME, Config::DBNAME, tableName);
+}
+
+bool isExpired(const CacheEntry& entry)
+{
+    return Config::SCHEMA_CACHE_TTL_MSECS > 0
+            && entry.m_age.hasExpired(Config::SCHEMA_CACHE_TTL_MSECS);
+}
+
+}
+
+/***************************************************************************************/
+
+SchemaCache::TableInfo SchemaCache::tableInfo(const QSqlDatabase& db, const QString& tableName)
+{
+    CacheEntry entry;
+    if (SchemaCache::cachedTableInfo(tableName, entry.m_info))
+        return entry.m_info;
+
+    QSqlRecord columns = db.record(tableName);
+    for(int i = 0; i < columns.count(); ++i)
+        entry.m_info.m_columnNames << columns.fieldName(i);
+
+    if (entry.m_info.m_columnNames.isEmpty())
+        return entry.m_info;
+
+    entry.m_info.m_primaryKey = db.primaryIndex(tableName).fieldName(0);
+    entry.m_tableName = tableName;
+    entry.m_age.start();
+
+    QWriteLocker locker(&CACHE_LOCK);
+    CACHE.insert(cacheKey(db.driverName(), db.hostName(), db.databaseName(), tableName), entry);
+
+    return entry.m_info;
+}
+
+bool SchemaCache::cachedTableInfo(const QString& tableName, TableInfo& info)
+{
+    QReadLocker locker(&CACHE_LOCK);
+    auto it = CACHE.constFind(configuredKey(tableName));
+    if (it == CACHE.constEnd() || isExpired(*it))
+        return false;
+
+    info = it->m_info;
+    return true;
+}
+
+void SchemaCache::invalidate(const QString& tableName)
+{
+    QWriteLocker locker(&CACHE_LOCK);
+    for (auto it = CACHE.begin(); it != CACHE.end(); )
+    {
+        if (it->m_tableName == tableName)
+            it = CACHE.erase(it);
+        else
+            ++it;
+    }
+}
+
+void SchemaCache::invalidateAll()
+{
+    QWriteLocker locker(&CACHE_LOCK);
+    CACHE.clear();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QStringList>
+
+QT_FORWARD_DECLARE_CLASS(QSqlDatabase)
+
+/*!
+ * \brief The SchemaCache class
+ * is a process-wide cache of table metadata (primary key & column names), so that
+ * constructing a Query or performing a JOIN does not cost a catalog round trip every time.
+ * Entries are keyed by the database (driver, host & database name) and the table name and are shared
+ * by all threads & connections, so switching Config to another database does not reuse the old entries.
+ * If the schema changes at runtime -- call invalidate(), or set Config::SCHEMA_CACHE_TTL_MSECS
+ * to make the entries expire. Missing tables are not cached.
+ */
+class SchemaCache
+{
+public:
+    /*!
+     * \brief The TableInfo struct
+     * is a cached metadata of one table
+     */
+    struct TableInfo
+    {
+        QString         m_primaryKey;
+        QStringList     m_columnNames;
+    };
+
+    /*!
+     * \brief tableInfo -- returns cached table metadata, querying the database on cache miss
+     * \param db        -- opened connection to be used on cache miss
+     * \param tableName -- name of the table to be examined
+     * \return          -- primary key and column names of the table, empty if the table does not exist
+     */
+    static TableInfo tableInfo(const QSqlDatabase& db, const QString& tableName);
+
+    /*!
+     * \brief cachedTableInfo   -- cache-only lookup in the database of the current Config params, never touches the database
+     * \param tableName         -- name of the table to be examined
+     * \param info              -- receives the cached metadata on hit
+     * \return                  -- true on cache hit
+     */
+    static bool cachedTableInfo(const QString& tableName, TableInfo& info);
+
+    /*!
+     * \brief invalidate    -- drops the cached metadata of the table, in all the databases
+     * \param tableName     -- name of the table, which schema has been changed
+     */
+    static void invalidate(const QString& tableName);
+
+    /*!
+     * \brief invalidateAll -- drops the whole cache
+     */
+    static void invalidateAll();
+};
@@ -1,21 +1,39 @@
 #include "Selector.h"
 #include "Query.h"
+#include "AsyncRunner.h"
+#include "SqlFormat.h"
+#include "Config.h"
+#include "ResultCache.h"
 
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QSet>
+#include <QHash>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QDataStream>
+
+#include <atomic>
+#include <algorithm>
 
 struct Selector::SelectorPrivate
 {
     SelectorPrivate(const Query* q, const QStringList& fields)
         : m_query(q)
         , m_fields(!fields.isEmpty() ? fields : q->columnNames())
-        , m_where{""}
+        , m_defaultFields(fields.isEmpty())
         , m_limit{""}
+        , m_limitCount(0)
         , m_order{""}
+        , m_orderType(Order::ASC)
+        , m_keysetValid(true)
         , m_having{""}
         , m_groupBy{""}
         , m_offset{""}
+        , m_cursorChunkSize(0)
+        , m_cached(false)
     { }
 
     struct JoinPart
@@ -27,10 +45,19 @@ struct Selector::SelectorPrivate
 
     const Query*        m_query;
     QStringList         m_fields;
+    bool                m_defaultFields;
 
-    QString             m_where;
+    OP::Clause          m_where;
+    QHash<QString, QString> m_qualifiedColumns; // ambiguous column : "table"."column" in the where
     QString             m_limit;
+    int                 m_limitCount;
     QString             m_order;
+    QStringList         m_orderFields;
+    Order::OrderType    m_orderType;
+
+    QVariantList        m_keysetValues; // after()/seek() position
+    bool                m_keysetValid;
+    QSqlError           m_keysetError;  // the position does not match the keyset, nothing is executed
 
     QString             m_having;
     QString             m_groupBy;
@@ -38,6 +65,12 @@ struct Selector::SelectorPrivate
 
     QList<JoinPart>     m_joinParts;
 
+    int                 m_cursorChunkSize; // 0 means no cursor
+    bool                m_cached;
+
+    QVariantList        m_partitionRange; // primary key bounds of a performParallel() part
+    QString             m_scalarFields;   // count()/aggregate() expression, replaces the fields & order
+
     // This should resolve disambiduation in column names
     void resolveColumnDisambiguation()
     {
@@ -47,27 +80,130 @@ struct Selector::SelectorPrivate
             QSet<QString> otherColumnSet = QSet<QString>::fromList(m_query->tableColumnNames(part.m_joinTable));
             otherColumnSet.intersect(thisColumnSet);
 
+            const QString resolutionTable = !part.m_joinDisambigToOther ? m_query->tableName() : part.m_joinTable;
+
             for(int i = 0; i < m_fields.count(); ++i)
             {
                 QString fieldName = m_fields[i];
                 if (otherColumnSet.contains(fieldName))
-                {
-                    QString resolutionFieldName = QString("%1.%2")
-                                                    .arg(!part.m_joinDisambigToOther
-                                                                ? m_query->tableName()
-                                                                : part.m_joinTable)
-                                                    .arg(fieldName);
-                    // hacky a bit, but IT WORKS
-                    m_where.replace(fieldName, resolutionFieldName);
-                    m_where.replace('.', "\".\"");
-                    m_fields.replace(i, resolutionFieldName);
-                }
+                    m_fields.replace(i, QString("%1.%2").arg(resolutionTable, fieldName));
+            }
+
+            // the where's columns are qualified when rendered, the first join wins as for the fields
+            for (const QString& fieldName : otherColumnSet)
+            {
+                if (!m_qualifiedColumns.contains(fieldName))
+                    m_qualifiedColumns.insert(fieldName, QString("\"%1\".\"%2\"").arg(resolutionTable, fieldName));
             }
         }
     }
 
+    QString whereSQL(QVariantList& bindValues) const
+    {
+        const bool arrayParameters = m_query->database().driverName() == "QPSQL";
+
+        return m_where.toSQL(bindValues, [this](const QString& field) {
+            // "table.column" is quoted by parts
+            if (field.contains('.') && !field.contains('"'))
+                return QString("\"%1\"").arg(field).replace('.', "\".\"");
+
+            return m_qualifiedColumns.value(field);
+        }, arrayParameters);
+    }
+
+    // the fields are plain (maybe qualified or quoted) columns, so COUNT(*) may replace them:
+    // DISTINCT, aggregates and other expressions change the number of rows
+    bool plainFields() const
+    {
+        for (const QString& field : m_fields)
+        {
+            if (field.isEmpty() || field.at(0).isDigit())
+                return false;
+
+            for (const QChar& c : field)
+            {
+                if (!c.isLetterOrNumber() && c != QLatin1Char('_') && c != QLatin1Char('.')
+                        && c != QLatin1Char('"') && c != QLatin1Char('*'))
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
     //-------
 
+    // tables the result depends on
+    QStringList tableNames() const
+    {
+        QStringList result {m_query->tableName()};
+        for (const auto& part: m_joinParts)
+            result << part.m_joinTable;
+
+        return result;
+    }
+
+    // ordering columns are the keyset, the primary key is the last one, so that rows with equal values are not skipped
+    QStringList keysetFields() const
+    {
+        const QString pkey = m_query->primaryKeyName();
+
+        QStringList fields = m_orderFields;
+        for (const QString& field : fields)
+        {
+            QString column = field;
+            column.remove('"');
+            if (column == pkey || column == QString("%1.%2").arg(m_query->tableName(), pkey))
+                return fields;
+        }
+
+        return fields << pkey;
+    }
+
+    // order of keyset pagination, by the keyset
+    QString keysetOrder() const
+    {
+        const QString direction = QVariant::fromValue(m_orderType).toString();
+
+        QStringList parts;
+        for (const QString& field : keysetFields())
+            parts << QString("%1 %2").arg(qualified(field), direction);
+
+        return QString("ORDER BY %1").arg(parts.join(", "));
+    }
+
+    // "(k1, k2) > (?, ?)" predicate, that continues after the keyset position
+    QString keysetPredicate() const
+    {
+        if (!m_keysetValid)
+            return "False";
+
+        QStringList fields, placeholders;
+        for (const QString& field : keysetFields())
+            fields << qualified(field);
+        for (int i = 0; i < m_keysetValues.count(); ++i)
+            placeholders << "?";
+
+        return QString("(%1) %2 (%3)")
+                .arg(fields.join(", "))
+                .arg(m_orderType == Order::ASC ? ">" : "<")
+                .arg(placeholders.join(", "));
+    }
+
+    // "pk BETWEEN ? AND ?" predicate of a performParallel() part
+    QString partitionPredicate() const
+    {
+        return QString("%1 BETWEEN ? AND ?").arg(qualified(m_query->primaryKeyName()));
+    }
+
+    // the target table's columns are qualified, so that joined ones don't make them ambiguous
+    QString qualified(const QString& field) const
+    {
+        return m_joinParts.isEmpty() || field.contains('.')
+                ? field
+                : QString("\"%1\".\"%2\"").arg(m_query->tableName(), field);
+    }
+
     QString getJoinTail() const
     {
         QString result;
@@ -87,6 +223,16 @@ struct Selector::SelectorPrivate
 /***************************************************************************************/
 
 const QString Selector::SELECT_SQL { "SELECT %1 FROM %2 %3 WHERE %4 %5;" };
+const QString Selector::DECLARE_CURSOR_SQL { "DECLARE %1 NO SCROLL CURSOR FOR %2;" };
+const QString Selector::FETCH_CURSOR_SQL { "FETCH FORWARD %1 FROM %2;" };
+const QString Selector::CLOSE_CURSOR_SQL { "CLOSE %1;" };
+const quint8  Selector::KEYSET_TOKEN_VERSION { 1 };
+const QString Selector::SCALAR_SUBQUERY_SQL { "SELECT %1 FROM (%2) AS sqlbuilder_scalar;" };
+const QString Selector::EXISTS_SQL { "SELECT EXISTS(%1);" };
+const QString Selector::KEY_RANGE_SQL { "SELECT MIN(%1), MAX(%1) FROM %2;" };
+const QString Selector::SNAPSHOT_ISOLATION_SQL { "SET TRANSACTION ISOLATION LEVEL REPEATABLE READ;" };
+const QString Selector::EXPORT_SNAPSHOT_SQL { "SELECT pg_export_snapshot();" };
+const QString Selector::IMPORT_SNAPSHOT_SQL { "SET TRANSACTION SNAPSHOT '%1';" };
 
 Selector::Selector(const Query* q, const QStringList& fields)
     : impl(new SelectorPrivate(q, fields))
@@ -115,7 +261,7 @@ Selector Selector::join(const QString& otherTable, const std::pair<QString, QStr
 
 Selector Selector::where(OP::Clause&& clause) &&
 {
-    impl->m_where = std::move(clause).getSQl();
+    impl->m_where = std::move(clause);
     return std::move(*this);
 }
 
@@ -124,12 +270,44 @@ Selector Selector::limit(int count) &&
     impl->m_limit = count > 0
                     ? QString("LIMIT %1").arg(count)
                     : "";
+    impl->m_limitCount = qMax(0, count);
     return std::move(*this);
 }
 
 Selector Selector::orderBy(const QString& field, Order::OrderType selectOrder) &&
 {
-    impl->m_order = QString("ORDER BY %1 %2").arg(field).arg(QVariant::fromValue(selectOrder).toString());
+    return std::move(*this).orderBy(QStringList{field}, selectOrder);
+}
+
+Selector Selector::orderBy(const QStringList& fields, Order::OrderType selectOrder) &&
+{
+    const QString direction = QVariant::fromValue(selectOrder).toString();
+
+    QStringList parts;
+    for (const QString& field : fields)
+        parts << QString("%1 %2").arg(field, direction);
+
+    impl->m_order = QString("ORDER BY %1").arg(parts.join(", "));
+    impl->m_orderFields = fields;
+    impl->m_orderType = selectOrder;
+    return std::move(*this);
+}
+
+Selector Selector::after(const QVariantList& keyValues) &&
+{
+    impl->m_keysetValues = keyValues;
+    impl->m_keysetValid = true;
+    return std::move(*this);
+}
+
+Selector Selector::seek(const QString& token) &&
+{
+    if (token.isEmpty())
+        return std::move(*this);
+
+    bool ok = false;
+    impl->m_keysetValues = decodeKeysetToken(token, ok);
+    impl->m_keysetValid = ok;
     return std::move(*this);
 }
 
@@ -151,36 +329,710 @@ Selector Selector::offset(int offset) &&
     return std::move(*this);
 }
 
+Selector Selector::cached() &&
+{
+    impl->m_cached = true;
+    return std::move(*this);
+}
+
+Selector Selector::cursor(int chunkSize) &&
+{
+    impl->m_cursorChunkSize = chunkSize;
+    return std::move(*this);
+}
+
+qint64 Selector::count() &&
+{
+    QueryStats stats;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVariantList bindValues;
+    const QString sql = buildScalarSQL("COUNT(*)", bindValues);
+    stats.m_generationNsecs = timer.nsecsElapsed();
+
+    return performScalar(sql, bindValues, stats).toLongLong();
+}
+
+bool Selector::exists() &&
+{
+    QueryStats stats;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // the server stops at the first row
+    if (impl->m_limit.isEmpty())
+        impl->m_limit = "LIMIT 1";
+
+    QVariantList bindValues;
+    QString statement = buildSQL(bindValues).trimmed();
+    if (statement.endsWith(QLatin1Char(';')))
+        statement.chop(1);
+
+    const QString sql = Selector::EXISTS_SQL.arg(statement);
+    stats.m_generationNsecs = timer.nsecsElapsed();
+
+    return performScalar(sql, bindValues, stats).toBool();
+}
+
+QVariant Selector::aggregate(Aggregate::Function function, const QString& column) &&
+{
+    QueryStats stats;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const QString expression = QString("%1(%2)")
+                                .arg(QVariant::fromValue(function).toString())
+                                .arg(column);
+
+    QVariantList bindValues;
+    const QString sql = buildScalarSQL(expression, bindValues);
+    stats.m_generationNsecs = timer.nsecsElapsed();
+
+    return performScalar(sql, bindValues, stats);
+}
+
+QString Selector::buildScalarSQL(const QString& expression, QVariantList& bindValues)
+{
+    if (impl->m_groupBy.isEmpty() && impl->m_having.isEmpty() && impl->m_limit.isEmpty() && impl->m_offset.isEmpty()
+            && impl->plainFields())
+    {
+        impl->m_scalarFields = expression;
+        return buildSQL(bindValues);
+    }
+
+    QString statement = buildSQL(bindValues).trimmed();
+    if (statement.endsWith(QLatin1Char(';')))
+        statement.chop(1);
+
+    return Selector::SCALAR_SUBQUERY_SQL.arg(expression, statement);
+}
+
+QVariant Selector::performScalar(const QString& sql, const QVariantList& bindValues, QueryStats& stats)
+{
+    QVariant result;
+
+    performChunks(sql, bindValues, stats, [&](QSqlQuery& q) {
+        if (q.next())
+        {
+            result = q.value(0);
+            stats.m_rowCount = 1;
+        }
+        return false;
+    });
+
+    Query::reportStats(stats);
+
+    return impl->m_query->hasError() ? QVariant() : result;
+}
+
 QVariantList Selector::perform() &&
 {
     QVariantList result;
+    QueryStats stats;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVariantList bindValues;
+    const QString sql = buildSQL(bindValues);
+    stats.m_generationNsecs = timer.nsecsElapsed();
+
+    // a transaction sees it's own uncommitted writes, the cache does not
+    const bool useCache = impl->m_cached && !Query::inTransaction() && !impl->m_keysetError.isValid();
+
+    QByteArray cacheKey;
+    quint64 cacheGeneration = 0;
+    if (useCache)
+    {
+        cacheKey = ResultCache::makeKey(sql, bindValues);
+        cacheGeneration = ResultCache::generation(impl->tableNames());
+        if (ResultCache::lookup(cacheKey, result))
+        {
+            stats.m_sql = sql;
+            stats.m_rowCount = result.count();
+            Query::reportStats(stats);
+
+            return result;
+        }
+    }
+
+    QStringList fieldNames;
+    QVector<QVariant> rowValues;
+    // per-row phase timing & byte counting cost nothing, when nobody reads the stats
+    const bool detailed = Query::statsEnabled();
+
+    performChunks(sql, bindValues, stats, [&](QSqlQuery& q) {
+        if (fieldNames.isEmpty())
+        {
+            QSqlRecord r = q.record();
+            for(int i = 0; i < r.count(); ++i)
+                fieldNames << r.fieldName(i);
+            rowValues.resize(fieldNames.count());
+        }
+
+        // fetching and materialization are interleaved, so the timer is read on each phase switch
+        qint64 mark = detailed ? timer.nsecsElapsed() : 0;
+
+        while(q.next())
+        {
+            for(int i = 0; i < rowValues.count(); ++i)
+                rowValues[i] = q.value(i);
+
+            if (detailed)
+            {
+                const qint64 now = timer.nsecsElapsed();
+                stats.m_fetchNsecs += now - mark;
+                mark = now;
+            }
+
+            QVariantMap resultRow;
+            for(int i = 0; i < rowValues.count(); ++i)
+            {
+                if (detailed)
+                    stats.m_resultBytes += QueryStats::approximateSize(rowValues[i]);
+                resultRow[fieldNames[i]] = rowValues[i];
+            }
+            result.append(resultRow);
+
+            if (detailed)
+            {
+                const qint64 now = timer.nsecsElapsed();
+                stats.m_materializationNsecs += now - mark;
+                mark = now;
+            }
+        }
+
+        if (detailed)
+            stats.m_fetchNsecs += timer.nsecsElapsed() - mark;
+        return true;
+    });
+
+    stats.m_rowCount = result.count();
+    Query::reportStats(stats);
+
+    // writes committed meanwhile make the result stale, store() skips it then
+    if (useCache && !impl->m_query->hasError())
+        ResultCache::store(cacheKey, impl->tableNames(), result, cacheGeneration);
+
+    return result;
+}
+
+int Selector::stream(const std::function<bool(const QVariantMap&)>& rowHandler) &&
+{
+    QueryStats stats;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QStringList fieldNames;
+    const bool detailed = Query::statsEnabled();
+
+    // same keys every row, so the map's nodes are reused instead of reallocated
+    QVariantMap row;
+
+    performChunks(stats, timer, [&](QSqlQuery& q) {
+        if (fieldNames.isEmpty())
+        {
+            QSqlRecord r = q.record();
+            for(int i = 0; i < r.count(); ++i)
+                fieldNames << r.fieldName(i);
+        }
+
+        qint64 mark = detailed ? timer.nsecsElapsed() : 0;
+
+        while(q.next())
+        {
+            for(int i = 0; i < fieldNames.count(); ++i)
+            {
+                row[fieldNames[i]] = q.value(i);
+                if (detailed)
+                    stats.m_resultBytes += QueryStats::approximateSize(row[fieldNames[i]]);
+            }
+            ++stats.m_rowCount;
+
+            if (detailed)
+                stats.m_fetchNsecs += timer.nsecsElapsed() - mark;
+
+            const bool proceed = rowHandler(row);
+
+            if (detailed)
+                mark = timer.nsecsElapsed();
+            if (!proceed)
+                return false;
+        }
+
+        if (detailed)
+            stats.m_fetchNsecs += timer.nsecsElapsed() - mark;
+        return true;
+    });
+
+    Query::reportStats(stats);
+
+    return stats.m_rowCount;
+}
+
+ColumnarResult Selector::performColumnar() &&
+{
+    ColumnarResult result;
+    QueryStats stats;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    performChunks(stats, timer, [&](QSqlQuery& q) {
+        if (result.columnCount() == 0)
+            result.setColumns(q.record());
+
+        // values are taken right into the columns, so there is no separate materialization phase
+        const qint64 mark = timer.nsecsElapsed();
+        while(q.next())
+            result.appendRow(q);
+
+        stats.m_fetchNsecs += timer.nsecsElapsed() - mark;
+        return true;
+    });
+
+    result.squeeze();
+    stats.m_rowCount = result.rowCount();
+
+    if (Query::statsEnabled())
+    {
+        for (int column = 0; column < result.columnCount(); ++column)
+        {
+            for (int row = 0; row < result.rowCount(); ++row)
+                stats.m_resultBytes += QueryStats::approximateSize(result.value(row, column));
+        }
+    }
+    Query::reportStats(stats);
+
+    return result;
+}
+
+void Selector::performMapped(const QStringList& columns, const std::function<void(const QSqlQuery&, const QVector<int>&)>& readRow)
+{
+    if (impl->m_defaultFields)
+        impl->m_fields = columns;
+
+    QueryStats stats;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<int> indexes;
+    const bool detailed = Query::statsEnabled();
+
+    performChunks(stats, timer, [&](QSqlQuery& q) {
+        // names are looked up once, rows are read by index
+        if (indexes.isEmpty())
+        {
+            const QSqlRecord r = q.record();
+            for (const QString& column : columns)
+                indexes << r.indexOf(column);
+        }
+
+        qint64 mark = detailed ? timer.nsecsElapsed() : 0;
+        while(q.next())
+        {
+            if (detailed)
+            {
+                const qint64 now = timer.nsecsElapsed();
+                stats.m_fetchNsecs += now - mark;
+                mark = now;
+            }
+
+            readRow(q, indexes);
+            ++stats.m_rowCount;
+
+            if (detailed)
+            {
+                const qint64 now = timer.nsecsElapsed();
+                stats.m_materializationNsecs += now - mark;
+                mark = now;
+            }
+        }
+
+        if (detailed)
+            stats.m_fetchNsecs += timer.nsecsElapsed() - mark;
+        return true;
+    });
+
+    Query::reportStats(stats);
+}
+
+void Selector::performChunks(QueryStats& stats, const QElapsedTimer& timer, const std::function<bool(QSqlQuery&)>& chunkHandler)
+{
+    QVariantList bindValues;
+    const QString sql = buildSQL(bindValues);
+    stats.m_generationNsecs = timer.nsecsElapsed();
+
+    performChunks(sql, bindValues, stats, chunkHandler);
+}
+
+void Selector::performChunks(const QString& sql, const QVariantList& bindValues, QueryStats& stats
+                             , const std::function<bool(QSqlQuery&)>& chunkHandler)
+{
+    const Query* query = impl->m_query;
+
+    if (impl->m_keysetError.isValid())
+    {
+        query->setLastError(impl->m_keysetError);
+        return;
+    }
+
+    const bool useCursor = impl->m_cursorChunkSize > 0 && query->database().driverName() == "QPSQL";
+    if (!useCursor)
+    {
+        QSqlQuery q = query->execute(sql, bindValues, stats);
+        chunkHandler(q);
+        q.finish();
+        return;
+    }
+
+    // cursors live in a transaction, joining the caller's one if there is any
+    if (!query->beginTransaction())
+        return;
+
+    static std::atomic<int> CURSOR_COUNTER {0};
+    const QString cursorName = QString("sqlbuilder_cursor_%1").arg(++CURSOR_COUNTER);
+
+    // DECLARE can't be prepared with parameters, so the values are inlined
+    QString statement = sql.trimmed();
+    if (statement.endsWith(QLatin1Char(';')))
+        statement.chop(1);
+    statement = SqlFormat::inlineValues(query->database().driver(), statement, bindValues);
+
+    query->executeRaw(Selector::DECLARE_CURSOR_SQL.arg(cursorName, statement), stats);
+    stats.m_sql = sql;
+
+    bool ok = !query->hasError();
+    const QString fetchSQL = Selector::FETCH_CURSOR_SQL.arg(impl->m_cursorChunkSize).arg(cursorName);
+
+    try
+    {
+        while (ok)
+        {
+            // only one chunk is kept by the driver at a time
+            QSqlQuery q = query->executeRaw(fetchSQL, stats);
+            if (query->hasError())
+            {
+                ok = false;
+                break;
+            }
+
+            const bool lastChunk = q.size() < impl->m_cursorChunkSize;
+            const bool proceed = chunkHandler(q);
+            q.finish();
+
+            if (lastChunk || !proceed)
+                break;
+        }
+    }
+    catch (...)
+    {
+        // the handler has thrown, neither the cursor nor the transaction may outlive it
+        query->executeRaw(Selector::CLOSE_CURSOR_SQL.arg(cursorName), stats);
+        query->endTransaction(false);
+        throw;
+    }
+    stats.m_sql = sql;
+
+    const QSqlError error = query->lastError();
+    if (ok)
+        query->executeRaw(Selector::CLOSE_CURSOR_SQL.arg(cursorName), stats);
+
+    query->endTransaction(ok);
+    if (error.isValid())
+        query->setLastError(error);
+}
+
+KeysetPage Selector::performPage() &&
+{
+    const QStringList keys = impl->keysetFields();
+    const int pageSize = impl->m_limitCount;
+
+    // the first page has no keyset position yet, but must be ordered by the keys as well
+    if (impl->m_order.isEmpty())
+        impl->m_orderType = Order::ASC;
+    impl->m_order = impl->keysetOrder();
+
+    // the last row must have the keys to make the token
+    for (const QString& key : keys)
+    {
+        if (!impl->m_fields.contains(key))
+            impl->m_fields << key;
+    }
+
+    KeysetPage page;
+    page.m_rows = std::move(*this).perform();
+
+    if (pageSize > 0 && page.m_rows.count() == pageSize)
+    {
+        const QVariantMap lastRow = page.m_rows.last().toMap();
+
+        QVariantList keyValues;
+        for (const QString& key : keys)
+        {
+            QString column = key.section('.', -1);
+            column.remove('"');
+            keyValues << lastRow.value(column);
+        }
+        page.m_nextToken = encodeKeysetToken(keyValues);
+    }
+
+    return page;
+}
+
+QString Selector::encodeKeysetToken(const QVariantList& keyValues)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_6); // tokens may outlive the application version
+    stream << KEYSET_TOKEN_VERSION << keyValues;
+
+    return QString::fromLatin1(data.toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals));
+}
+
+QVariantList Selector::decodeKeysetToken(const QString& token, bool& ok)
+{
+    const QByteArray data = QByteArray::fromBase64(token.toLatin1(), QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals);
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_6);
+
+    quint8 version = 0;
+    QVariantList keyValues;
+    stream >> version >> keyValues;
+
+    ok = stream.status() == QDataStream::Ok && version == KEYSET_TOKEN_VERSION && !keyValues.isEmpty();
+    return ok ? keyValues : QVariantList();
+}
+
+QFuture<QVariantList> Selector::performAsync() &&
+{
+    const Query* origin = impl->m_query;
+    std::shared_ptr<Selector> selector = std::make_shared<Selector>(std::move(*this));
+
+    return runAsync<QVariantList>(*origin, [selector](const Query& query) {
+        selector->impl->m_query = &query;
+        return std::move(*selector).perform();
+    });
+}
+
+QVariantList Selector::performParallel(int partitions, bool consistentSnapshot) &&
+{
+    const Query* query = impl->m_query;
+    const QString pkey = query->primaryKeyName();
+
+    // parts are concatenated, that keeps the order only when it is the primary key's one,
+    // the other connections would not see the caller's uncommitted data either
+    const bool keyOrder = impl->m_orderFields.isEmpty()
+                        || (impl->m_orderFields.count() == 1 && impl->m_orderFields.first().section('.', -1).remove('"') == pkey);
+
+    if (partitions < 2 || pkey.isEmpty() || !keyOrder || !impl->m_limit.isEmpty() || !impl->m_offset.isEmpty()
+        || !impl->m_groupBy.isEmpty() || Query::inTransaction())
+    {
+        return std::move(*this).perform();
+    }
+
+    QueryStats stats;
+    QString snapshot;
+
+    // the caller's transaction exports it's snapshot, so the parts see the same data, as the key range does
+    if (consistentSnapshot && query->database().driverName() == "QPSQL")
+    {
+        if (!query->beginTransaction())
+        {
+            query->setLastError(query->database().lastError());
+            return QVariantList();
+        }
+
+        query->executeRaw(Selector::SNAPSHOT_ISOLATION_SQL, stats);
+        QSqlQuery q = query->executeRaw(Selector::EXPORT_SNAPSHOT_SQL, stats);
+        if (q.next())
+            snapshot = q.value(0).toString();
+
+        if (snapshot.isEmpty())
+        {
+            const QSqlError error = query->lastError();
+            query->endTransaction(false);
+            query->setLastError(error);
+            return QVariantList();
+        }
+    }
+
+    QSqlQuery range = query->executeRaw(Selector::KEY_RANGE_SQL.arg(pkey, query->tableName()), stats);
+    QVariant low, high;
+    if (range.next())
+    {
+        low = range.value(0);
+        high = range.value(1);
+    }
+    range.finish();
+
+    const QSqlError rangeError = query->lastError();
+    const auto isInteger = [](const QVariant& value) {
+        const int type = value.userType();
+        return !value.isNull()
+                && (type == QMetaType::Int || type == QMetaType::UInt || type == QMetaType::LongLong || type == QMetaType::ULongLong);
+    };
+
+    // an empty table, an error or a key, that can't be split
+    if (rangeError.isValid() || !isInteger(low) || !isInteger(high))
+    {
+        if (!snapshot.isEmpty())
+            query->endTransaction(!rangeError.isValid());
+
+        if (rangeError.isValid())
+        {
+            query->setLastError(rangeError);
+            return QVariantList();
+        }
+
+        return low.isNull() ? QVariantList() : std::move(*this).perform();
+    }
+
+    const qint64 minKey = low.toLongLong();
+    const qint64 span = high.toLongLong() - minKey + 1;
+    const int count = static_cast<int>(qMin<qint64>(partitions, span));
+    const qint64 step = span / count;
+    const qint64 remainder = span % count;
+
+    // each part is performed by a copy of this generator on it's own thread & connection
+    const std::shared_ptr<const SelectorPrivate> prototype = std::make_shared<SelectorPrivate>(*impl);
+
+    QList<QFuture<QVariantList>> parts;
+    qint64 partLow = minKey;
+    for (int i = 0; i < count; ++i)
+    {
+        const qint64 partHigh = partLow + step - 1 + (i < remainder ? 1 : 0);
+        const QVariantList bounds {partLow, partHigh};
+        partLow = partHigh + 1;
+
+        parts << runAsync<QVariantList>(*query, [prototype, bounds, snapshot](const Query& worker) -> QVariantList {
+            // a part, that is run by the waiting caller's thread itself, is in the exporting transaction already
+            const bool importSnapshot = !snapshot.isEmpty() && !Query::inTransaction();
+            if (importSnapshot)
+            {
+                QueryStats importStats;
+                if (!worker.beginTransaction())
+                {
+                    worker.setLastError(worker.database().lastError());
+                    return QVariantList();
+                }
+
+                worker.executeRaw(Selector::SNAPSHOT_ISOLATION_SQL, importStats);
+                worker.executeRaw(Selector::IMPORT_SNAPSHOT_SQL.arg(snapshot), importStats);
+                if (worker.hasError())
+                {
+                    const QSqlError error = worker.lastError();
+                    worker.endTransaction(false);
+                    worker.setLastError(error);
+                    return QVariantList();
+                }
+            }
+
+            Selector part = worker.select();
+            *part.impl = *prototype;
+            part.impl->m_query = &worker;
+            part.impl->m_partitionRange = bounds;
+
+            QVariantList rows = std::move(part).perform();
+
+            if (importSnapshot)
+            {
+                const QSqlError error = worker.lastError();
+                worker.endTransaction(!error.isValid());
+                worker.setLastError(error);
+            }
+
+            return rows;
+        });
+    }
+
+    // parts are ordered by the key ascending, each one is ordered inside by the query itself
+    if (impl->m_orderType == Order::DESC && !impl->m_orderFields.isEmpty())
+        std::reverse(parts.begin(), parts.end());
+
+    QVariantList result;
+    QSqlError error;
+    for (QFuture<QVariantList>& part : parts)
+    {
+        try
+        {
+            result << part.result();
+        }
+        catch (const QueryError& e)
+        {
+            if (!error.isValid())
+                error = e.error();
+        }
+    }
+
+    if (!snapshot.isEmpty())
+        query->endTransaction(true);
+
+    if (error.isValid())
+    {
+        query->setLastError(error);
+        return QVariantList();
+    }
+
+    return result;
+}
+
+QString Selector::buildSQL(QVariantList& bindValues)
+{
     impl->resolveColumnDisambiguation();
 
+    bindValues.clear();
+    QString where = impl->whereSQL(bindValues);
+    if (!impl->m_keysetValues.isEmpty() || !impl->m_keysetValid)
+    {
+        const int keyCount = impl->keysetFields().count();
+        if (impl->m_keysetValid && impl->m_keysetValues.count() != keyCount)
+        {
+            impl->m_keysetError = QSqlError(QString("Selector: %1 keyset values for %2 keyset columns (%3)")
+                                                .arg(impl->m_keysetValues.count()).arg(keyCount)
+                                                .arg(impl->keysetFields().join(", "))
+                                            , QString(), QSqlError::StatementError);
+            impl->m_keysetValid = false;
+            impl->m_keysetValues.clear();
+        }
+
+        const QString predicate = impl->keysetPredicate();
+        where = where.isEmpty() ? predicate : QString("(%1) AND %2").arg(where, predicate);
+        bindValues << impl->m_keysetValues;
+    }
+
+    if (!impl->m_partitionRange.isEmpty())
+    {
+        const QString predicate = impl->partitionPredicate();
+        where = where.isEmpty() ? predicate : QString("(%1) AND %2").arg(where, predicate);
+        bindValues << impl->m_partitionRange;
+    }
+
+    QString order = impl->m_order;
+    if (!impl->m_keysetValues.isEmpty())
+        order = impl->keysetOrder();
+
+    // an aggregate over all the rows has nothing to order
+    if (!impl->m_scalarFields.isEmpty())
+        order.clear();
+
     const QStringList tail = QStringList()
                             << impl->m_groupBy
                             << impl->m_having
-                            << impl->m_order
+                            << order
                             << impl->m_limit
                             << impl->m_offset;
 
-    const QString sql = Selector::SELECT_SQL
-                    .arg(impl->m_fields.join(", "))
+    return Selector::SELECT_SQL
+                    .arg(impl->m_scalarFields.isEmpty() ? impl->m_fields.join(", ") : impl->m_scalarFields)
                     .arg(impl->m_query->tableName())
                     .arg(impl->getJoinTail())
-                    .arg(impl->m_where.isEmpty() ? "True" : impl->m_where)
+                    .arg(where.isEmpty() ? "True" : where)
                     .arg(tail.join(" "));
-
-    QSqlQuery q = impl->m_query->performSQL(sql);
-    QSqlRecord r = q.record();
-
-    while(q.next())
-    {
-        QVariantMap resultRow;
-        for(int i = 0; i < r.count(); ++i)
-            resultRow[r.fieldName(i)] = q.value(i);
-
-        result.append(resultRow);
-    }
-
-    return result;
 }
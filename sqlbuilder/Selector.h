@@ -1,10 +1,17 @@
 #pragma once
 
 #include <memory>
+#include <functional>
 #include <QVariant>
+#include <QFuture>
 
 #include "Where.h"
+#include "ColumnarResult.h"
+#include "RowMapping.h"
+#include "QueryStats.h"
+#include "Config.h"
 QT_FORWARD_DECLARE_CLASS(Query)
+QT_FORWARD_DECLARE_CLASS(QElapsedTimer)
 
 //--------------------------- *** helpers go here *** ----------------------------------//
 
@@ -54,6 +61,44 @@ public:
     Q_ENUM(OrderType)
 };
 
+//---
+
+/*!
+ * \brief The Aggregate class
+ * is a convenient wrapper for aggregate
+ * function enum (see Selector::aggregate()).
+ */
+class Aggregate
+{
+    Q_GADGET
+public:
+    /*!
+     * \brief The Function enum
+     * (surprise) enums aggregate functions
+     */
+    enum Function
+    {
+        SUM, // SUM(column)
+        MIN, // MIN(column)
+        MAX, // MAX(column)
+        AVG  // AVG(column)
+    };
+    Q_ENUM(Function)
+};
+
+//---
+
+/*!
+ * \brief The KeysetPage struct
+ * is a page of keyset pagination (see Selector::performPage()), the rows plus
+ * an opaque token to continue from, pass it to Selector::seek() for the next page.
+ */
+struct KeysetPage
+{
+    QVariantList    m_rows;
+    QString         m_nextToken; // empty, if it was the last page
+};
+
 /***************************************************************************************/
 
 /*!
@@ -128,6 +173,32 @@ public:
      */
     Selector orderBy(const QString& field, Order::OrderType selectOrder) &&;
 
+    /*!
+     * \brief orderBy       -- "ORDER BY f1 ASC/DESC, f2 ASC/DESC ..." part, same direction for all the columns
+     * \param fields        -- column names for ordering by, in order of priority
+     * \param selectOrder   -- ASC/DESC order type
+     * \return              -- this generator as rvalue to be reused
+     */
+    Selector orderBy(const QStringList& fields, Order::OrderType selectOrder) &&;
+
+    /*!
+     * \brief after     -- keyset pagination, continues after the row with the given ordering keys: adds
+     * "(k1, k2, pk) > (v1, v2, v3)" predicate ("<" for DESC) over the orderBy() columns and the primary key (unless it is
+     * one of them already), the rows are ordered by the same columns. Unlike offset() it does not make the server skip
+     * rows, so deep pages are as fast as the first one. A wrong number of values fails the query (see Query::lastError())
+     * \param keyValues -- values of the orderBy() columns and then of the primary key of the last row of the previous page
+     * \return          -- this generator as rvalue to be reused
+     */
+    Selector after(const QVariantList& keyValues) &&;
+
+    /*!
+     * \brief seek      -- same as after(), but takes the token of the previous page (see performPage()).
+     * Empty token means the first page, a broken one gives an empty page
+     * \param token     -- KeysetPage's m_nextToken
+     * \return          -- this generator as rvalue to be reused
+     */
+    Selector seek(const QString& token) &&;
+
     /*!
      * \brief groupBy   -- "GROUP BY ..." part
      * \param field     -- column name to be grouped by
@@ -149,15 +220,159 @@ public:
      */
     Selector offset(int offset) &&;
 
+    /*!
+     * \brief cursor    -- PostgreSQL server-side cursor mode for huge results: the query is declared as a cursor
+     * in a transaction (joining the caller's one, if any) and read by "FETCH n" chunks, so the client never holds
+     * more than one chunk and the first rows arrive sooner. Best used with stream(), works with all the perform
+     * methods. Other drivers ignore it, as the values are inlined into DECLARE, don't put "?" into raw parts.
+     * \param chunkSize -- rows per FETCH
+     * \return          -- this generator as rvalue to be reused
+     */
+    Selector cursor(int chunkSize = Config::CURSOR_CHUNK_SIZE) &&;
+
+    /*!
+     * \brief cached    -- opts in to the process-wide result cache (see ResultCache) for perform():
+     * same SQL with same values returns the cached rows, until a generator writes to any of the tables read
+     * \return          -- this generator as rvalue to be reused
+     */
+    Selector cached() &&;
+
+    /*!
+     * \brief count     -- executes "SELECT COUNT(*)" with the same joins & where instead of the query, nothing but
+     * the number is sent back. Grouped, limited, DISTINCT or aggregate queries (anything but plain columns selected)
+     * are counted as a subquery, so it is the number of their rows
+     * \return          -- number of rows, the query would return, 0 on error (see Query::lastError())
+     */
+    qint64 count() &&;
+
+    /*!
+     * \brief exists    -- executes "SELECT EXISTS(... LIMIT 1)", the server stops at the first matching row
+     * \return          -- true, if the query would return any rows
+     */
+    bool exists() &&;
+
+    /*!
+     * \brief aggregate -- executes "SELECT SUM/MIN/MAX/AVG(column)" with the same joins & where. Grouped, limited,
+     * DISTINCT or aggregate queries are aggregated as a subquery, then the column is one of the selected ones (or their aliases)
+     * \param function  -- aggregate function
+     * \param column    -- column name to be aggregated, qualify it, if it is ambiguous in JOINs
+     * \return          -- the value, null if there were no rows or on error
+     */
+    QVariant aggregate(Aggregate::Function function, const QString& column) &&;
+
     /*!
      * \brief perform   -- executes the query, returning the data
      * \return          -- list of QVariantMaps with keys similar to columns & aliases provided earlier
      */
     QVariantList perform() &&;
 
+    /*!
+     * \brief perform   -- executes the query, filling the rows right into structs, declared with SQLBUILDER_ROW.
+     * Columns are matched to the fields by name once per query, rows are read by index, no maps involved.
+     * If no fields were given to Query::select(), the struct's fields are selected.
+     * \return          -- rows of the result
+     */
+    template<typename T>
+    QVector<T> perform() &&;
+
+    /*!
+     * \brief stream        -- executes the query, handing the rows over one at a time instead of collecting them,
+     * so memory does not depend on the result size (the query is forward-only, drivers like QPSQL don't buffer it).
+     * The connection is busy until the streaming ends, so don't perform other queries of this thread in the handler.
+     * \param rowHandler    -- receives each row like perform() would return it (the map is reused between the calls,
+     * copy it if you need to keep it), returns false to stop early
+     * \return              -- number of rows handed over
+     */
+    int stream(const std::function<bool(const QVariantMap&)>& rowHandler) &&;
+
+    /*!
+     * \brief performColumnar   -- executes the query, returning the data by columns: contiguous typed vectors
+     * with null bitmaps instead of a map per row, for wide or long results and bulk processing
+     * \return                  -- the data, columns named like perform() map keys
+     */
+    ColumnarResult performColumnar() &&;
+
+    /*!
+     * \brief performPage   -- executes the query as a page of keyset pagination, limit() is the page size.
+     * The ordering columns and the primary key (the tie-breaker of equal values) are added to the selected ones, if missing,
+     * they make the token
+     * \return              -- the rows like perform() returns and the token for the next page
+     */
+    KeysetPage performPage() &&;
+
+    /*!
+     * \brief performAsync  -- executes the query on Query::asyncExecutor() thread pool, on that thread's own connection,
+     * so the caller is not blocked. The generator is consumed, the Query it was created by is not used anymore (it may be
+     * destroyed meanwhile), that also means the query is not a part of the caller's transaction.
+     * \return              -- future with the data like perform() returns, it's result() throws QueryError on failure
+     */
+    QFuture<QVariantList> performAsync() &&;
+
+    /*!
+     * \brief performParallel       -- executes the query by parts on Query::asyncExecutor(): the primary key range
+     * is split into disjoint "pk BETWEEN x AND y" parts, each one is performed on it's own thread & connection, so
+     * the server scans them by several backends too. The rows are concatenated in the key order. Falls back to perform()
+     * if the order is not the primary key's one, with limit()/offset()/groupBy(), inside a transaction (the parts would not
+     * see it's data) or if the primary key is not an integer. The parts are as even, as the keys are dense.
+     * \param partitions            -- number of parts, Config::ASYNC_THREADS and Config::POOL_SIZE bound how many run at once
+     * \param consistentSnapshot    -- PostgreSQL: the parts import the caller's exported snapshot (REPEATABLE READ),
+     * so they all see the same data, as if it was one query. Ignored by other drivers
+     * \return                      -- data like perform() returns, empty on error (see Query::lastError())
+     */
+    QVariantList performParallel(int partitions, bool consistentSnapshot = false) &&;
+
 private:
+    friend class Batch;
+
+    // generates the SQL with placeholders, filling the values to be bound
+    QString buildSQL(QVariantList& bindValues);
+
+    // generates "SELECT expression FROM ..." over the query's rows, grouped or limited ones become a subquery
+    QString buildScalarSQL(const QString& expression, QVariantList& bindValues);
+
+    // executes the scalar SQL, returning the first column of the first row
+    QVariant performScalar(const QString& sql, const QVariantList& bindValues, QueryStats& stats);
+
+    // executes the query, handing the result to chunkHandler at once or by FETCH chunks in cursor mode,
+    // chunkHandler returns false to stop early; the generation phase is timed by the timer
+    void performChunks(QueryStats& stats, const QElapsedTimer& timer, const std::function<bool(QSqlQuery&)>& chunkHandler);
+    void performChunks(const QString& sql, const QVariantList& bindValues, QueryStats& stats
+                       , const std::function<bool(QSqlQuery&)>& chunkHandler);
+
+    // executes the query, handing each row to readRow with the columns' indexes in the result
+    void performMapped(const QStringList& columns, const std::function<void(const QSqlQuery&, const QVector<int>&)>& readRow);
+
     struct SelectorPrivate;
     std::unique_ptr<SelectorPrivate> impl;
 
     static const QString SELECT_SQL;
+    static const QString DECLARE_CURSOR_SQL;
+    static const QString FETCH_CURSOR_SQL;
+    static const QString CLOSE_CURSOR_SQL;
+
+    static const QString SCALAR_SUBQUERY_SQL;
+    static const QString EXISTS_SQL;
+
+    static const QString KEY_RANGE_SQL;
+    static const QString SNAPSHOT_ISOLATION_SQL;
+    static const QString EXPORT_SNAPSHOT_SQL;
+    static const QString IMPORT_SNAPSHOT_SQL;
+
+    // continuation token is a versioned QDataStream of the key values, in base64
+    static QString encodeKeysetToken(const QVariantList& keyValues);
+    static QVariantList decodeKeysetToken(const QString& token, bool& ok);
+    static const quint8 KEYSET_TOKEN_VERSION;
 };
+
+template<typename T>
+QVector<T> Selector::perform() &&
+{
+    QVector<T> result;
+    performMapped(RowMapping<T>::columns(), [&result](const QSqlQuery& q, const QVector<int>& indexes) {
+        T row = T(); // value-initialized, columns missing in the result leave zeros
+        RowMapping<T>::read(q, indexes, row);
+        result.append(row);
+    });
+
+    return result;
+}
@@ -0,0 +1,227 @@
+#include "SlowQueryLog.h"
+#include "SqlFormat.h"
+#include "Config.h"
+
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlError>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+
+#include <atomic>
+
+namespace
+{
+
+std::atomic<int>    THRESHOLD_MSECS { 0 };
+QMutex              LOG_MUTEX;
+QString             LOG_PATH;
+
+const QString       EXPLAIN_CONNECTION { "sqlbuilder_explain" };
+const QStringList   EXPLAINABLE { "SELECT", "INSERT", "UPDATE", "DELETE", "WITH" };
+
+// records waiting for their plans, the ones beyond Config::SLOW_LOG_MAX_PENDING are written without a plan
+std::atomic<int>    PENDING_PLANS { 0 };
+
+// the same statement is re-run by EXPLAIN ANALYZE that rarely, plain EXPLAIN is used in between
+const qint64        ANALYZE_INTERVAL_MSECS { 60000 };
+const int           ANALYZED_STATEMENTS_LIMIT { 1024 };
+
+// single thread, so that the explain connection is always used by the thread that created it
+QThreadPool* explainExecutor()
+{
+    static QThreadPool executor;
+    static const bool configured = [] {
+        executor.setMaxThreadCount(1);
+        executor.setExpiryTimeout(-1);
+        return true;
+    }();
+    Q_UNUSED(configured)
+
+    return &executor;
+}
+
+// explainExecutor() thread only
+QSqlDatabase explainConnection()
+{
+    if (QSqlDatabase::contains(EXPLAIN_CONNECTION))
+        return QSqlDatabase::database(EXPLAIN_CONNECTION);
+
+    QSqlDatabase db = QSqlDatabase::addDatabase(Config::DRIVER, EXPLAIN_CONNECTION);
+    db.setDatabaseName(Config::DBNAME);
+    db.setHostName(Config::HOSTNAME);
+    db.setUserName(Config::USERNAME);
+    db.setPassword(Config::PASSWORD);
+    db.open();
+
+    return db;
+}
+
+// explainExecutor() thread only: whether the statement may be executed again by ANALYZE now
+bool analyzeAllowed(const QString& statement)
+{
+    static QHash<QString, QElapsedTimer> LAST_ANALYZED;
+
+    auto it = LAST_ANALYZED.find(statement);
+    if (it != LAST_ANALYZED.end())
+    {
+        if (!it->hasExpired(ANALYZE_INTERVAL_MSECS))
+            return false;
+
+        it->start();
+        return true;
+    }
+
+    if (LAST_ANALYZED.count() >= ANALYZED_STATEMENTS_LIMIT)
+    {
+        for (auto stale = LAST_ANALYZED.begin(); stale != LAST_ANALYZED.end(); )
+        {
+            if (stale->hasExpired(ANALYZE_INTERVAL_MSECS))
+                stale = LAST_ANALYZED.erase(stale);
+            else
+                ++stale;
+        }
+
+        if (LAST_ANALYZED.count() >= ANALYZED_STATEMENTS_LIMIT)
+            return false;
+    }
+
+    LAST_ANALYZED[statement].start();
+    return true;
+}
+
+QString explainSQL(const QString& driverName, const QString& statement)
+{
+    const QString verb = statement.section(' ', 0, 0).toUpper();
+    if (!EXPLAINABLE.contains(verb))
+        return QString();
+
+    if (driverName == "QSQLITE")
+        return "EXPLAIN QUERY PLAN " + statement;
+
+    // ANALYZE executes the statement, writes must not be repeated, nor the same slow SELECT over and over
+    if (driverName == "QPSQL" && verb == "SELECT" && analyzeAllowed(statement))
+        return "EXPLAIN (ANALYZE, BUFFERS) " + statement;
+
+    return "EXPLAIN " + statement;
+}
+
+QString capturePlan(const QString& driverName, const QString& statement)
+{
+    const QString sql = explainSQL(driverName, statement);
+    if (sql.isEmpty())
+        return "(not explainable)";
+
+    QSqlDatabase db = explainConnection();
+    if (!db.isOpen())
+        return QString("(no connection: %1)").arg(db.lastError().text());
+
+    QSqlQuery q(db);
+    if (!q.exec(sql))
+        return QString("(EXPLAIN failed: %1)").arg(q.lastError().text());
+
+    QStringList planLines;
+    while (q.next())
+    {
+        QStringList columns;
+        for (int i = 0; i < q.record().count(); ++i)
+            columns << q.value(i).toString();
+
+        planLines << columns.join(" | ");
+    }
+
+    return planLines.join("\n");
+}
+
+// LOG_MUTEX should be locked
+void rotate(const QString& path)
+{
+    const int maxFiles = qMax(1, Config::SLOW_LOG_MAX_FILES);
+
+    QFile::remove(QString("%1.%2").arg(path).arg(maxFiles));
+    for (int i = maxFiles - 1; i >= 1; --i)
+        QFile::rename(QString("%1.%2").arg(path).arg(i), QString("%1.%2").arg(path).arg(i + 1));
+
+    QFile::rename(path, path + ".1");
+}
+
+void append(const QString& entry)
+{
+    QMutexLocker locker(&LOG_MUTEX);
+    if (LOG_PATH.isEmpty())
+        return;
+
+    if (QFileInfo(LOG_PATH).size() >= Config::SLOW_LOG_MAX_BYTES)
+        rotate(LOG_PATH);
+
+    QFile file(LOG_PATH);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+        file.write(entry.toUtf8());
+}
+
+}
+
+/***************************************************************************************/
+
+void SlowQueryLog::setup(int thresholdMsecs, const QString& filePath)
+{
+    {
+        QMutexLocker locker(&LOG_MUTEX);
+        LOG_PATH = filePath;
+    }
+    THRESHOLD_MSECS = filePath.isEmpty() ? 0 : thresholdMsecs;
+}
+
+bool SlowQueryLog::isSlow(qint64 elapsedNsecs)
+{
+    const int threshold = THRESHOLD_MSECS;
+    return threshold > 0 && elapsedNsecs >= threshold * qint64(1000000);
+}
+
+void SlowQueryLog::record(const QSqlDatabase& db, const QString& sql, const QVariantList& bindValues
+                          , const QString& tag, qint64 elapsedNsecs)
+{
+    // the caller's connection is not touched on the other thread, just it's driver formatting here
+    const QString driverName = db.driverName();
+    const QString statement = db.driver() ? SqlFormat::inlineValues(db.driver(), sql.trimmed(), bindValues)
+                                          : sql.trimmed();
+
+    QStringList binds;
+    for (const QVariant& value : bindValues)
+        binds << (value.isNull() ? QString("NULL") : value.toString());
+
+    // multi-arg, so that '%' in the SQL itself is left alone
+    const QString header = QString("%1 [%2] %3 ms\n%4\nbinds: (%5)\n")
+            .arg(QDateTime::currentDateTime().toString(Qt::ISODateWithMs)
+                 , tag
+                 , QString::number(elapsedNsecs / 1000000.0, 'f', 3)
+                 , sql.trimmed()
+                 , binds.join(", "));
+
+    // an overloaded server makes everything slow, the plans must not add to the load nor pile up
+    if (PENDING_PLANS.fetch_add(1) >= qMax(0, Config::SLOW_LOG_MAX_PENDING))
+    {
+        --PENDING_PLANS;
+        append(QString("%1plan:\n(skipped, too many plans pending)\n\n").arg(header));
+        return;
+    }
+
+    QtConcurrent::run(explainExecutor(), [driverName, statement, header]() {
+        append(QString("%1plan:\n%2\n\n").arg(header, capturePlan(driverName, statement)));
+        --PENDING_PLANS;
+    });
+}
+
+void SlowQueryLog::waitForDone()
+{
+    explainExecutor()->waitForDone();
+}
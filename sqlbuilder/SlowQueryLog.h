@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QString>
+#include <QVariant>
+
+QT_FORWARD_DECLARE_CLASS(QSqlDatabase)
+
+/*!
+ * \brief The SlowQueryLog class
+ * is an internal writer of the slow query log (see Query::setSlowQueryLogging()).
+ * Statements slower than the threshold are written to a rotating file together with
+ * their bind values, the Query's tag and the plan. Plans are captured on a background
+ * thread with it's own connection, so the caller is not delayed by EXPLAIN. Only SELECT
+ * is explained with ANALYZE (it executes the statement again), once a minute per statement text
+ * at most, writes and repeated statements get a plain EXPLAIN. Records beyond
+ * Config::SLOW_LOG_MAX_PENDING waiting for their plans are written without one.
+ */
+class SlowQueryLog
+{
+public:
+    /*!
+     * \brief setup             -- sets the threshold and the log file
+     * \param thresholdMsecs    -- statements running at least that long are logged, 0 disables the log
+     * \param filePath          -- path of the log file, rotated ones get ".1", ".2", ... suffixes
+     */
+    static void setup(int thresholdMsecs, const QString& filePath);
+
+    /*!
+     * \brief isSlow        -- checks the execution time against the threshold
+     * \param elapsedNsecs  -- execution time of a statement
+     * \return              -- if the statement should be logged
+     */
+    static bool isSlow(qint64 elapsedNsecs);
+
+    /*!
+     * \brief record        -- queues the statement to be explained and logged
+     * \param db            -- connection, that performed the statement (used for it's driver only)
+     * \param sql           -- statement text, with placeholders if any
+     * \param bindValues    -- values bound to the placeholders
+     * \param tag           -- tag of the Query, that performed it
+     * \param elapsedNsecs  -- execution time
+     */
+    static void record(const QSqlDatabase& db, const QString& sql, const QVariantList& bindValues
+                       , const QString& tag, qint64 elapsedNsecs);
+
+    /*!
+     * \brief waitForDone -- blocks until all the queued records are written
+     */
+    static void waitForDone();
+};
@@ -0,0 +1,229 @@
+#include "SqlEscape.h"
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define SQLBUILDER_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define SQLBUILDER_SSE2
+#endif
+
+namespace
+{
+const ushort QUOTE { '\'' };
+
+inline int bitCount(unsigned mask)
+{
+    int count = 0;
+    for (; mask; mask &= mask - 1)
+        ++count;
+
+    return count;
+}
+
+#if defined(SQLBUILDER_SSE2)
+// 16 nibbles to their hex digits: n + '0', plus ('a' - '0' - 10) for n > 9
+inline __m128i hexDigits(__m128i nibbles)
+{
+    const __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 10));
+    return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+}
+#endif
+
+#if defined(SQLBUILDER_AVX2)
+inline __m256i hexDigits(__m256i nibbles)
+{
+    const __m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(nibbles, _mm256_set1_epi8(9)), _mm256_set1_epi8('a' - '0' - 10));
+    return _mm256_add_epi8(_mm256_add_epi8(nibbles, _mm256_set1_epi8('0')), letters);
+}
+#endif
+}
+
+namespace SqlEscape
+{
+
+void hexEncodeScalar(const uchar* data, int length, ushort* out)
+{
+    static const char hexchars[] = "0123456789abcdef";
+    for (int i = 0; i < length; ++i)
+    {
+        *out++ = ushort(hexchars[data[i] >> 4]);
+        *out++ = ushort(hexchars[data[i] & 0x0f]);
+    }
+}
+
+void hexEncode(const uchar* data, int length, ushort* out)
+{
+    int i = 0;
+
+#if defined(SQLBUILDER_AVX2)
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    for (; i + 32 <= length; i += 32)
+    {
+        // qwords 0,2,1,3: in-lane unpacking then gives the digits of bytes 0..15 & 16..31 in order
+        const __m256i bytes = _mm256_permute4x64_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), 0xD8);
+        const __m256i high = hexDigits(_mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+        const __m256i low = hexDigits(_mm256_and_si256(bytes, mask));
+
+        const __m256i first = _mm256_unpacklo_epi8(high, low);
+        const __m256i second = _mm256_unpackhi_epi8(high, low);
+
+        __m256i* target = reinterpret_cast<__m256i*>(out + 2 * i);
+        _mm256_storeu_si256(target,     _mm256_cvtepu8_epi16(_mm256_castsi256_si128(first)));
+        _mm256_storeu_si256(target + 1, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(first, 1)));
+        _mm256_storeu_si256(target + 2, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(second)));
+        _mm256_storeu_si256(target + 3, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(second, 1)));
+    }
+#elif defined(SQLBUILDER_SSE2)
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i high = hexDigits(_mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+        const __m128i low = hexDigits(_mm_and_si128(bytes, mask));
+
+        const __m128i first = _mm_unpacklo_epi8(high, low);
+        const __m128i second = _mm_unpackhi_epi8(high, low);
+
+        // latin1 digits widened to UTF-16
+        __m128i* target = reinterpret_cast<__m128i*>(out + 2 * i);
+        _mm_storeu_si128(target,     _mm_unpacklo_epi8(first, zero));
+        _mm_storeu_si128(target + 1, _mm_unpackhi_epi8(first, zero));
+        _mm_storeu_si128(target + 2, _mm_unpacklo_epi8(second, zero));
+        _mm_storeu_si128(target + 3, _mm_unpackhi_epi8(second, zero));
+    }
+#endif
+
+    hexEncodeScalar(data + i, length - i, out + 2 * i);
+}
+
+int countQuotes(const ushort* text, int length)
+{
+    int count = 0;
+    int i = 0;
+
+#if defined(SQLBUILDER_AVX2)
+    const __m256i quote = _mm256_set1_epi16(QUOTE);
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+        count += bitCount(unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi16(chars, quote)))) / 2;
+    }
+#elif defined(SQLBUILDER_SSE2)
+    const __m128i quote = _mm_set1_epi16(QUOTE);
+    for (; i + 8 <= length; i += 8)
+    {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        count += bitCount(unsigned(_mm_movemask_epi8(_mm_cmpeq_epi16(chars, quote)))) / 2;
+    }
+#endif
+
+    for (; i < length; ++i)
+        count += text[i] == QUOTE ? 1 : 0;
+
+    return count;
+}
+
+void doubleQuotes(const ushort* text, int length, ushort* out)
+{
+    int i = 0;
+
+    // blocks without quotes are copied as they are, the rare ones with quotes go the scalar way
+#if defined(SQLBUILDER_AVX2)
+    const __m256i quote = _mm256_set1_epi16(QUOTE);
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(chars, quote)) == 0)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), chars);
+            out += 16;
+            continue;
+        }
+
+        for (int j = i; j < i + 16; ++j)
+        {
+            if (text[j] == QUOTE)
+                *out++ = QUOTE;
+            *out++ = text[j];
+        }
+    }
+#elif defined(SQLBUILDER_SSE2)
+    const __m128i quote = _mm_set1_epi16(QUOTE);
+    for (; i + 8 <= length; i += 8)
+    {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(chars, quote)) == 0)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), chars);
+            out += 8;
+            continue;
+        }
+
+        for (int j = i; j < i + 8; ++j)
+        {
+            if (text[j] == QUOTE)
+                *out++ = QUOTE;
+            *out++ = text[j];
+        }
+    }
+#endif
+
+    for (; i < length; ++i)
+    {
+        if (text[i] == QUOTE)
+            *out++ = QUOTE;
+        *out++ = text[i];
+    }
+}
+
+QString quotedText(const QString& text, bool trimmed)
+{
+    // trimmed in place, without a copy
+    int begin = 0;
+    int end = text.size();
+    while (trimmed && begin < end && text.at(begin).isSpace())
+        ++begin;
+    while (trimmed && end > begin && text.at(end - 1).isSpace())
+        --end;
+
+    const ushort* source = text.utf16() + begin;
+    const int length = end - begin;
+
+    QString result(length + countQuotes(source, length) + 2, Qt::Uninitialized);
+    ushort* out = reinterpret_cast<ushort*>(result.data());
+
+    out[0] = QUOTE;
+    doubleQuotes(source, length, out + 1);
+    out[result.size() - 1] = QUOTE;
+
+    return result;
+}
+
+QString quotedHex(const QByteArray& data)
+{
+    return hexLiteral(data, "'", "'");
+}
+
+QString hexLiteral(const QByteArray& data, const char* open, const char* close)
+{
+    const int openLength = int(qstrlen(open));
+    const int closeLength = int(qstrlen(close));
+
+    QString result(openLength + 2 * data.size() + closeLength, Qt::Uninitialized);
+    ushort* out = reinterpret_cast<ushort*>(result.data());
+
+    for (int i = 0; i < openLength; ++i)
+        *out++ = uchar(open[i]);
+
+    hexEncode(reinterpret_cast<const uchar*>(data.constData()), data.size(), out);
+    out += 2 * data.size();
+
+    for (int i = 0; i < closeLength; ++i)
+        *out++ = uchar(close[i]);
+
+    return result;
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+
+/*!
+ * Internal kernels for long text & binary literals, used by OP::Clause::escapeValue() and by
+ * SqlFormat::inlineValues() (batches, slow query log, cursors): the output is sized once and filled
+ * by 16/32 bytes at a time with SSE2/AVX2 (when the compiler targets them), scalar code otherwise.
+ */
+namespace SqlEscape
+{
+    /*!
+     * \brief quotedText    -- makes a literal of the text: quotes doubled, in single quotes
+     * \param text          -- the text
+     * \param trimmed       -- whitespace around the text is dropped (as escapeValue() always did)
+     * \return              -- 'text'
+     */
+    QString quotedText(const QString& text, bool trimmed = true);
+
+    /*!
+     * \brief quotedHex     -- makes a literal of the data as lowercase hex digits, in single quotes
+     * \param data          -- the data
+     * \return              -- 'hex'
+     */
+    QString quotedHex(const QByteArray& data);
+
+    /*!
+     * \brief hexLiteral    -- same, but with the dialect's own framing, like X'...' of SQLite or decode('...', 'hex') of PostgreSQL
+     * \param data          -- the data
+     * \param open          -- latin1 text before the digits
+     * \param close         -- latin1 text after the digits
+     * \return              -- open + hex + close
+     */
+    QString hexLiteral(const QByteArray& data, const char* open, const char* close);
+
+    // the kernels write into presized buffers, the scalar ones handle the tails & other CPUs
+    void hexEncode(const uchar* data, int length, ushort* out);
+    void hexEncodeScalar(const uchar* data, int length, ushort* out);
+
+    int countQuotes(const ushort* text, int length);
+    void doubleQuotes(const ushort* text, int length, ushort* out);
+}
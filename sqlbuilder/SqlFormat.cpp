@@ -0,0 +1,53 @@
+#include "SqlFormat.h"
+#include "SqlEscape.h"
+
+#include <QSqlDriver>
+#include <QSqlField>
+
+namespace
+{
+// text & binary literals of the known dialects are made by the vectorized kernels, the rest by the driver
+QString formatValue(const QSqlDriver* driver, const QVariant& value)
+{
+    const QSqlDriver::DbmsType dbms = driver->dbmsType();
+    if (!value.isNull() && (dbms == QSqlDriver::PostgreSQL || dbms == QSqlDriver::SQLite))
+    {
+        if (value.type() == QVariant::String)
+        {
+            // backslashes depend on standard_conforming_strings of the PostgreSQL server, the driver knows it
+            const QString text = value.toString();
+            if (dbms == QSqlDriver::SQLite || !text.contains(QLatin1Char('\\')))
+                return SqlEscape::quotedText(text, false);
+        }
+        else if (value.type() == QVariant::ByteArray)
+        {
+            // hex digits only, so it means the same whatever standard_conforming_strings is
+            return dbms == QSqlDriver::PostgreSQL ? SqlEscape::hexLiteral(value.toByteArray(), "decode('", "', 'hex')")
+                                                  : SqlEscape::hexLiteral(value.toByteArray(), "X'", "'");
+        }
+    }
+
+    QSqlField field(QString(), value.type());
+    field.setValue(value);
+    return driver->formatValue(field);
+}
+}
+
+QString SqlFormat::inlineValues(const QSqlDriver* driver, const QString& sql, const QVariantList& values)
+{
+    QString result;
+    result.reserve(sql.size() + values.count() * 8);
+
+    int valueIndex = 0;
+    for (const QChar c : sql)
+    {
+        if (c == QLatin1Char('?') && valueIndex < values.count())
+        {
+            result += formatValue(driver, values[valueIndex++]);
+        }
+        else
+            result += c;
+    }
+
+    return result;
+}
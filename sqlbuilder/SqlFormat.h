@@ -0,0 +1,23 @@
+#pragma once
+
+#include <QString>
+#include <QVariant>
+
+QT_FORWARD_DECLARE_CLASS(QSqlDriver)
+
+/*!
+ * Internal helpers for turning generated SQL into plain text,
+ * for the cases where binding is not possible (multi-statement batches, EXPLAIN).
+ */
+namespace SqlFormat
+{
+    /*!
+     * \brief inlineValues  -- replaces positional "?" placeholders with literals, formatted by the driver;
+     * text & binary values on PostgreSQL and SQLite are escaped by the SqlEscape kernels instead
+     * \param driver        -- driver of the connection the text is meant for
+     * \param sql           -- SQL with placeholders
+     * \param values        -- values for the placeholders, in order
+     * \return              -- SQL text without placeholders
+     */
+    QString inlineValues(const QSqlDriver* driver, const QString& sql, const QVariantList& values);
+}
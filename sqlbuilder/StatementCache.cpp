@@ -0,0 +1,57 @@
+#include "StatementCache.h"
+
+#include <QSqlDatabase>
+
+StatementCache::StatementCache(int capacity)
+    : m_capacity(capacity)
+{ }
+
+StatementCache::~StatementCache()
+{ }
+
+QSqlQuery StatementCache::prepared(const QSqlDatabase& db, const QString& sql, bool& ok, bool forwardOnly)
+{
+    // the mode can't be changed once prepared, so the same SQL may be cached in both;
+    // the text is taken as is, whitespace in literals matters
+    const QString key = (forwardOnly ? QString() : QString("scrollable:")) + sql;
+
+    auto it = m_statements.find(key);
+    if (it != m_statements.end())
+    {
+        if (!it->isActive())
+        {
+            m_usageOrder.removeOne(key);
+            m_usageOrder.append(key);
+
+            ok = true;
+            return *it;
+        }
+
+        // the cached one is still being read by somebody
+        QSqlQuery statement(db);
+        statement.setForwardOnly(forwardOnly);
+        ok = statement.prepare(sql);
+        return statement;
+    }
+
+    QSqlQuery statement(db);
+    statement.setForwardOnly(forwardOnly);
+    ok = statement.prepare(sql);
+
+    if (ok && m_capacity > 0)
+    {
+        if (m_statements.count() >= m_capacity)
+            m_statements.remove(m_usageOrder.takeFirst());
+
+        m_statements.insert(key, statement);
+        m_usageOrder.append(key);
+    }
+
+    return statement;
+}
+
+void StatementCache::clear()
+{
+    m_statements.clear();
+    m_usageOrder.clear();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QHash>
+#include <QStringList>
+#include <QSqlQuery>
+
+QT_FORWARD_DECLARE_CLASS(QSqlDatabase)
+
+/*!
+ * \brief The StatementCache class
+ * is a small LRU cache of prepared statements of one connection, so that generators'
+ * SQL with the same shape is parsed & planned by the server once, only values change.
+ * Statements are keyed by the exact SQL text (generators' SQL is stable anyway). Each pooled
+ * connection owns one cache (see ConnectionPool), Query uses it for bind-parameter execution.
+ * A cached statement, that is still active (it's results have not been finished) is considered
+ * busy, then a one-time statement is prepared instead of reusing it. The generators' statements are
+ * forward-only, so drivers may hand rows over as they arrive instead of buffering the whole result,
+ * scrollable ones (for the public Query::performSQL()) are cached separately.
+ * Not thread-safe, it is used by the connection's own thread only.
+ */
+class StatementCache
+{
+    Q_DISABLE_COPY(StatementCache)
+public:
+    /*!
+     * \brief StatementCache    -- constructor, obviously
+     * \param capacity          -- maximum number of statements being kept
+     */
+    explicit StatementCache(int capacity);
+    ~StatementCache();
+
+    /*!
+     * \brief prepared      -- returns the prepared statement for the SQL, preparing it on cache miss
+     * \param db            -- connection, the cache belongs to
+     * \param sql           -- SQL text with positional placeholders
+     * \param ok            -- is set to false if the statement could not be prepared (see it's lastError())
+     * \param forwardOnly   -- forward-only statement, seek()/previous() and size() do not work on it then
+     * \return              -- statement, ready to be bound & executed
+     */
+    QSqlQuery prepared(const QSqlDatabase& db, const QString& sql, bool& ok, bool forwardOnly = true);
+
+    /*!
+     * \brief clear -- drops all the statements, must be called before the connection is closed
+     */
+    void clear();
+
+private:
+    const int                   m_capacity;
+
+    QHash<QString, QSqlQuery>   m_statements;
+    QStringList                 m_usageOrder; // least recently used go first
+};
@@ -0,0 +1,116 @@
+#include "StaticQuery.h"
+#include "Query.h"
+
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QElapsedTimer>
+
+const QString StaticQueryRunner::SELECT_SQL { "SELECT %1 FROM %2 WHERE %3 %4;" };
+const QString StaticQueryRunner::INSERT_SQL { "INSERT INTO %1 (%2) VALUES (%3) RETURNING %4;" };
+const QString StaticQueryRunner::UPDATE_SQL { "UPDATE %1 SET %2 WHERE %3;" };
+
+namespace
+{
+QStringList quoted(const QStringList& columns, const QString& suffix = QString())
+{
+    QStringList result;
+    for (const QString& column : columns)
+        result << QString("\"%1\"%2").arg(column, suffix);
+
+    return result;
+}
+}
+
+QString StaticQueryRunner::selectSQL(const QString& table, const QStringList& columns, const QString& where, const QString& order)
+{
+    return StaticQueryRunner::SELECT_SQL
+                    .arg(quoted(columns).join(", "))
+                    .arg(table)
+                    .arg(where.isEmpty() ? "True" : where)
+                    .arg(order);
+}
+
+QString StaticQueryRunner::insertSQL(const QString& table, const QStringList& columns, const QString& primaryKey)
+{
+    QStringList placeholders;
+    for (int i = 0; i < columns.count(); ++i)
+        placeholders << "?";
+
+    return StaticQueryRunner::INSERT_SQL
+                    .arg(table)
+                    .arg(quoted(columns).join(','))
+                    .arg(placeholders.join(','))
+                    .arg(primaryKey);
+}
+
+QString StaticQueryRunner::updateSQL(const QString& table, const QStringList& columns, const QString& where)
+{
+    return StaticQueryRunner::UPDATE_SQL
+                    .arg(table)
+                    .arg(quoted(columns, "=?").join(','))
+                    .arg(where.isEmpty() ? "True" : where);
+}
+
+QVariantList StaticQueryRunner::select(const Query& query, const QString& sql, const QVariantList& bindValues)
+{
+    QVariantList result;
+    QueryStats stats;
+
+    QSqlQuery q = query.execute(sql, bindValues, stats);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QStringList fieldNames;
+    const QSqlRecord r = q.record();
+    for(int i = 0; i < r.count(); ++i)
+        fieldNames << r.fieldName(i);
+
+    while(q.next())
+    {
+        QVariantMap resultRow;
+        for(int i = 0; i < fieldNames.count(); ++i)
+            resultRow[fieldNames[i]] = q.value(i);
+        result.append(resultRow);
+    }
+    q.finish();
+
+    // fetching & materialization are not told apart here
+    stats.m_fetchNsecs = timer.nsecsElapsed();
+    stats.m_rowCount = result.count();
+    Query::reportStats(stats);
+
+    return result;
+}
+
+QList<int> StaticQueryRunner::insert(const Query& query, const QString& sql, const QVariantList& bindValues, const QString& table)
+{
+    QList<int> result;
+    QueryStats stats;
+
+    QSqlQuery q = query.execute(sql, bindValues, stats);
+    query.notifyWrite(table);
+
+    while(q.next())
+        result.append(q.value(0).toInt());
+    q.finish();
+
+    stats.m_rowCount = result.count();
+    Query::reportStats(stats);
+
+    return result;
+}
+
+bool StaticQueryRunner::update(const Query& query, const QString& sql, const QVariantList& bindValues, const QString& table)
+{
+    QueryStats stats;
+
+    QSqlQuery q = query.execute(sql, bindValues, stats);
+    query.notifyWrite(table);
+    stats.m_rowCount = qMax(0, q.numRowsAffected());
+    q.finish();
+
+    Query::reportStats(stats);
+
+    return stats.m_rowCount > 0;
+}
@@ -0,0 +1,310 @@
+#pragma once
+
+#include <type_traits>
+#include <QStringList>
+#include <QVariant>
+
+#include "Selector.h"
+
+QT_FORWARD_DECLARE_CLASS(Query)
+
+/*!
+ * Here go the generators of queries with the shape known at compile time: table, columns, where and order
+ * are types, so the SQL text is made once per shape (a function static) and only the values are bound
+ * at runtime, no SQL is generated per call. The number and types of the values are checked by the compiler.
+ * Declare the descriptors with the macros at namespace scope:
+ *
+ *     SQLBUILDER_TABLE(Items, "items", "_id")
+ *     SQLBUILDER_COLUMN(ItemId, "_id", int)
+ *     SQLBUILDER_COLUMN(ItemName, "name", QString)
+ *
+ *     using InsertItem = StaticInsert<Items, StaticColumns<ItemId, ItemName>>;
+ *     using ItemsByName = StaticSelect<Items, StaticColumns<ItemId, ItemName>, StaticWhere<StaticOP::EQ<ItemName>>>;
+ *
+ *     QList<int> ids = InsertItem::perform(query, 1, "lol");
+ *     QVariantList rows = ItemsByName::perform(query, "lol");
+ */
+
+/*!
+ * \brief SQLBUILDER_TABLE  -- declares a table descriptor
+ * \param Type              -- name of the descriptor type
+ * \param sqlName           -- name of the table
+ * \param primaryKey        -- name of it's primary key column, returned by inserts
+ */
+#define SQLBUILDER_TABLE(Type, sqlName, primaryKey) \
+    struct Type \
+    { \
+        static QString name() { return QStringLiteral(sqlName); } \
+        static QString primaryKeyName() { return QStringLiteral(primaryKey); } \
+    };
+
+/*!
+ * \brief SQLBUILDER_COLUMN -- declares a column descriptor
+ * \param Type              -- name of the descriptor type
+ * \param sqlName           -- name of the column
+ * \param ValueType         -- C++ type, the values of the column must be convertible to
+ */
+#define SQLBUILDER_COLUMN(Type, sqlName, ValueType) \
+    struct Type \
+    { \
+        using type = ValueType; \
+        static QString name() { return QStringLiteral(sqlName); } \
+    };
+
+/*!
+ * \brief The StaticQueryRunner class
+ * is an internal class, that executes the static queries' SQL, on the Query's connection,
+ * with the statement cache, stats and cache invalidation as the usual generators do.
+ */
+class StaticQueryRunner
+{
+public:
+    static QString selectSQL(const QString& table, const QStringList& columns, const QString& where, const QString& order);
+    static QString insertSQL(const QString& table, const QStringList& columns, const QString& primaryKey);
+    static QString updateSQL(const QString& table, const QStringList& columns, const QString& where);
+
+    static QVariantList select(const Query& query, const QString& sql, const QVariantList& bindValues);
+    static QList<int> insert(const Query& query, const QString& sql, const QVariantList& bindValues, const QString& table);
+    static bool update(const Query& query, const QString& sql, const QVariantList& bindValues, const QString& table);
+
+private:
+    static const QString SELECT_SQL;
+    static const QString INSERT_SQL;
+    static const QString UPDATE_SQL;
+};
+
+//--------------------------- *** shape descriptors *** ----------------------------------//
+
+/*!
+ * \brief The StaticColumns struct
+ * is a list of column descriptors
+ */
+template<typename... Columns>
+struct StaticColumns
+{
+    static constexpr int count = sizeof...(Columns);
+
+    static QStringList names()
+    {
+        return QStringList{ Columns::name()... };
+    }
+};
+
+namespace StaticDetail
+{
+    inline QString predicate(const QString& column, const char* op, const char* value)
+    {
+        return QString("\"%1\" %2 %3").arg(column, QLatin1String(op), QLatin1String(value));
+    }
+
+    // concatenates the lists of columns, the values are bound to
+    template<typename... Lists> struct Concat;
+
+    template<>
+    struct Concat<>
+    {
+        using type = StaticColumns<>;
+    };
+
+    template<typename... As, typename... Lists>
+    struct Concat<StaticColumns<As...>, Lists...>
+    {
+        template<typename Rest> struct Prepend;
+        template<typename... Bs> struct Prepend<StaticColumns<Bs...>> { using type = StaticColumns<As..., Bs...>; };
+
+        using type = typename Prepend<typename Concat<Lists...>::type>::type;
+    };
+
+    // checks, that each value is convertible to it's column's type
+    template<typename Columns, typename... Values>
+    struct Accepts : std::false_type {};
+
+    template<>
+    struct Accepts<StaticColumns<>> : std::true_type {};
+
+    template<typename Column, typename... Columns, typename Value, typename... Values>
+    struct Accepts<StaticColumns<Column, Columns...>, Value, Values...>
+        : std::integral_constant<bool, std::is_convertible<Value, typename Column::type>::value
+                                        && Accepts<StaticColumns<Columns...>, Values...>::value>
+    {};
+}
+
+/*!
+ * Predicates of the static where, each one binds the values of it's column
+ */
+namespace StaticOP
+{
+#define SQLBUILDER_STATIC_OP(NAME, op) \
+    template<typename Column> \
+    struct NAME \
+    { \
+        using Bound = StaticColumns<Column>; \
+        static QString sql() { return StaticDetail::predicate(Column::name(), op, "?"); } \
+    };
+
+    SQLBUILDER_STATIC_OP(EQ,  "=")
+    SQLBUILDER_STATIC_OP(NEQ, "!=")
+    SQLBUILDER_STATIC_OP(LT,  "<")
+    SQLBUILDER_STATIC_OP(GT,  ">")
+    SQLBUILDER_STATIC_OP(LE,  "<=")
+    SQLBUILDER_STATIC_OP(GE,  ">=")
+
+#undef SQLBUILDER_STATIC_OP
+
+    template<typename Column>
+    struct IS_NULL
+    {
+        using Bound = StaticColumns<>;
+        static QString sql() { return StaticDetail::predicate(Column::name(), "IS", "NULL"); }
+    };
+}
+
+/*!
+ * \brief The StaticWhere struct
+ * is a conjunction of StaticOP predicates, "(p1) AND (p2) ...", no predicates mean all the rows
+ */
+template<typename... Predicates>
+struct StaticWhere
+{
+    using Bound = typename StaticDetail::Concat<typename Predicates::Bound...>::type;
+
+    static QString sql()
+    {
+        const QStringList parts { Predicates::sql()... };
+        return parts.count() > 1 ? QString("(%1)").arg(parts.join(") AND (")) : parts.join(QString());
+    }
+};
+
+/*!
+ * \brief The StaticOrder struct
+ * is "ORDER BY col ASC/DESC" part
+ */
+template<typename Column, Order::OrderType Type = Order::ASC>
+struct StaticOrder
+{
+    static QString sql()
+    {
+        return QString("ORDER BY \"%1\" %2").arg(Column::name(), QVariant::fromValue(Type).toString());
+    }
+};
+
+/*!
+ * \brief The StaticNoOrder struct
+ * is the absent order
+ */
+struct StaticNoOrder
+{
+    static QString sql()
+    {
+        return QString();
+    }
+};
+
+//--------------------------- *** generators *** ----------------------------------//
+
+/*!
+ * \brief The StaticSelect class
+ * is SELECT of a fixed shape
+ */
+template<typename Table, typename Columns, typename Where = StaticWhere<>, typename OrderBy = StaticNoOrder>
+class StaticSelect
+{
+public:
+    /*!
+     * \brief sql   -- the SQL text of the shape, made once
+     * \return      -- SQL with "?" placeholders
+     */
+    static const QString& sql()
+    {
+        static const QString SQL = StaticQueryRunner::selectSQL(Table::name(), Columns::names(), Where::sql(), OrderBy::sql());
+        return SQL;
+    }
+
+    /*!
+     * \brief perform   -- executes the query
+     * \param query     -- Query, which connection is used, check it's lastError() as usually
+     * \param values    -- values of the where's predicates, in order
+     * \return          -- list of QVariantMaps, like Selector::perform() returns
+     */
+    template<typename... Values>
+    static QVariantList perform(const Query& query, Values&&... values)
+    {
+        static_assert(sizeof...(Values) == Where::Bound::count, "the number of values must match the where's predicates");
+        static_assert(StaticDetail::Accepts<typename Where::Bound, typename std::decay<Values>::type...>::value
+                      , "the values must be convertible to their columns' types");
+
+        return StaticQueryRunner::select(query, sql(), QVariantList{ QVariant(values)... });
+    }
+};
+
+/*!
+ * \brief The StaticInsert class
+ * is INSERT of one row of a fixed shape
+ */
+template<typename Table, typename Columns>
+class StaticInsert
+{
+public:
+    /*!
+     * \brief sql   -- the SQL text of the shape, made once
+     * \return      -- SQL with "?" placeholders
+     */
+    static const QString& sql()
+    {
+        static const QString SQL = StaticQueryRunner::insertSQL(Table::name(), Columns::names(), Table::primaryKeyName());
+        return SQL;
+    }
+
+    /*!
+     * \brief perform   -- executes the query
+     * \param query     -- Query, which connection is used, check it's lastError() as usually
+     * \param values    -- values of the columns, in order
+     * \return          -- list with the inserted record's id or empty list on failure
+     */
+    template<typename... Values>
+    static QList<int> perform(const Query& query, Values&&... values)
+    {
+        static_assert(sizeof...(Values) == Columns::count, "the number of values must match the number of columns");
+        static_assert(StaticDetail::Accepts<Columns, typename std::decay<Values>::type...>::value
+                      , "the values must be convertible to their columns' types");
+
+        return StaticQueryRunner::insert(query, sql(), QVariantList{ QVariant(values)... }, Table::name());
+    }
+};
+
+/*!
+ * \brief The StaticUpdate class
+ * is UPDATE of a fixed shape, the values of the columns go first, the where's ones go next
+ */
+template<typename Table, typename Columns, typename Where = StaticWhere<>>
+class StaticUpdate
+{
+public:
+    /*!
+     * \brief sql   -- the SQL text of the shape, made once
+     * \return      -- SQL with "?" placeholders
+     */
+    static const QString& sql()
+    {
+        static const QString SQL = StaticQueryRunner::updateSQL(Table::name(), Columns::names(), Where::sql());
+        return SQL;
+    }
+
+    /*!
+     * \brief perform   -- executes the query
+     * \param query     -- Query, which connection is used, check it's lastError() as usually
+     * \param values    -- values of the columns, then values of the where's predicates
+     * \return          -- true, if any rows were updated
+     */
+    template<typename... Values>
+    static bool perform(const Query& query, Values&&... values)
+    {
+        using Bound = typename StaticDetail::Concat<Columns, typename Where::Bound>::type;
+
+        static_assert(sizeof...(Values) == Bound::count, "the number of values must match the columns & the where's predicates");
+        static_assert(StaticDetail::Accepts<Bound, typename std::decay<Values>::type...>::value
+                      , "the values must be convertible to their columns' types");
+
+        return StaticQueryRunner::update(query, sql(), QVariantList{ QVariant(values)... }, Table::name());
+    }
+};
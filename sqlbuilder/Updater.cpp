@@ -1,7 +1,12 @@
 #include "Updater.h"
 #include "Query.h"
+#include "AsyncRunner.h"
 
 #include<QSqlQuery>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QVector>
 
 struct Updater::UpdaterPrivate
 {
@@ -13,7 +18,7 @@ struct Updater::UpdaterPrivate
     const Query*        m_query;
     const QVariantMap   m_updateValues;
 
-    QString             m_where;
+    OP::Clause          m_where;
 };
 
 const QString Updater::UPDATE_SQL { "UPDATE %1 SET %2 WHERE %3" };
@@ -31,25 +36,189 @@ Updater::Updater(Updater &&) = default;
 
 Updater Updater::where(OP::Clause&& clause) &&
 {
-    impl->m_where = std::move(clause).getSQl();
+    impl->m_where = std::move(clause);
     return std::move(*this);
 }
 
 bool Updater::perform() &&
+{
+    QueryStats stats;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVariantList bindValues;
+    const QString sql = buildSQL(bindValues);
+    stats.m_generationNsecs = timer.nsecsElapsed();
+
+    QSqlQuery q = impl->m_query->execute(sql, bindValues, stats);
+    impl->m_query->notifyWrite(tableName());
+    stats.m_rowCount = qMax(0, q.numRowsAffected());
+    q.finish();
+
+    Query::reportStats(stats);
+
+    return stats.m_rowCount > 0;
+}
+
+QFuture<bool> Updater::performAsync() &&
+{
+    const Query* origin = impl->m_query;
+    std::shared_ptr<Updater> updater = std::make_shared<Updater>(std::move(*this));
+
+    return runAsync<bool>(*origin, [updater](const Query& query) {
+        updater->impl->m_query = &query;
+        return std::move(*updater).perform();
+    });
+}
+
+QString Updater::tableName() const
+{
+    return impl->m_query->tableName();
+}
+
+QString Updater::buildSQL(QVariantList& bindValues) const
 {
     QStringList setPart;
-    for(const QString& key : impl->m_updateValues.keys())
+    for(auto it = impl->m_updateValues.constBegin(); it != impl->m_updateValues.constEnd(); ++it)
     {
-        setPart << QString("\"%1\"=%2")
-                               .arg(key)
-                               .arg(OP::Clause::escapeValue(impl->m_updateValues[key]));
+        setPart << QString("\"%1\"=?").arg(it.key());
+        bindValues << it.value();
     }
 
-    const QString sql = Updater::UPDATE_SQL
+    const bool arrayParameters = impl->m_query->database().driverName() == "QPSQL";
+    const QString where = impl->m_where.toSQL(bindValues, OP::Clause::ColumnResolver(), arrayParameters);
+
+    return Updater::UPDATE_SQL
                     .arg(impl->m_query->tableName())
                     .arg(setPart.join(','))
-                    .arg(impl->m_where.isEmpty() ? "True" : impl->m_where);
+                    .arg(where.isEmpty() ? "True" : where);
+}
+
+/***************************************************************************************/
+
+struct UpdaterBatch::UpdaterBatchPrivate
+{
+    UpdaterBatchPrivate(const Query* q, const QStringList& fields, const QString& keyField)
+        : m_query(q)
+        , m_fields(fields)
+        , m_keyField(keyField)
+        , m_columns(fields.count())
+    {}
+
+    const Query*        m_query;
+    const QStringList   m_fields;
+    const QString       m_keyField;
+
+    // the values are kept by columns, as they are bound
+    QVector<QVariantList> m_columns;
+    QSqlError           m_rowError;     // a row of a wrong length, reported by perform()
+};
+
+const QString UpdaterBatch::UPDATE_BATCH_SQL { "UPDATE %1 SET %2 WHERE \"%3\"=?;" };
+
+UpdaterBatch::UpdaterBatch(const Query* q, const QStringList& fields, const QString& keyField)
+    : impl(new UpdaterBatchPrivate(q, fields, keyField))
+{ }
+
+UpdaterBatch::~UpdaterBatch()
+{ }
+
+UpdaterBatch::UpdaterBatch(UpdaterBatch &&) = default;
+
+// out of line, so that the rows can be added in a loop
+UpdaterBatch& UpdaterBatch::operator=(UpdaterBatch &&) = default;
+
+UpdaterBatch UpdaterBatch::values(const QVariantList& data) &&
+{
+    if (data.count() != impl->m_fields.count())
+    {
+        if (!impl->m_rowError.isValid())
+        {
+            impl->m_rowError = QSqlError(QString("UpdaterBatch: a row of %1 values for %2 fields")
+                                            .arg(data.count()).arg(impl->m_fields.count()), QString(), QSqlError::StatementError);
+        }
+        return std::move(*this);
+    }
+
+    for (int i = 0; i < impl->m_columns.count(); ++i)
+        impl->m_columns[i] << data[i];
+
+    return std::move(*this);
+}
+
+bool UpdaterBatch::perform() &&
+{
+    const Query* query = impl->m_query;
+    const int keyIndex = impl->m_fields.indexOf(impl->m_keyField);
+
+    if (keyIndex < 0 || impl->m_fields.count() < 2)
+    {
+        query->setLastError(QSqlError(QString("UpdaterBatch: key field \"%1\" is not among the fields or nothing to set")
+                                            .arg(impl->m_keyField), QString(), QSqlError::StatementError));
+        return false;
+    }
+
+    if (impl->m_rowError.isValid())
+    {
+        query->setLastError(impl->m_rowError);
+        return false;
+    }
+
+    if (impl->m_columns[keyIndex].isEmpty())
+        return true;
+
+    QueryStats stats;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // SET columns in order, the key goes last
+    QStringList setPart;
+    QList<QVariantList> columns;
+    for (int i = 0; i < impl->m_fields.count(); ++i)
+    {
+        if (i == keyIndex)
+            continue;
+
+        setPart << QString("\"%1\"=?").arg(impl->m_fields[i]);
+        columns << impl->m_columns[i];
+    }
+    columns << impl->m_columns[keyIndex];
+
+    const QString sql = UpdaterBatch::UPDATE_BATCH_SQL
+                            .arg(query->tableName())
+                            .arg(setPart.join(','))
+                            .arg(impl->m_keyField);
+    stats.m_generationNsecs = timer.nsecsElapsed();
+
+    // drivers without array binding execute row by row, the transaction keeps it atomic
+    if (!query->beginTransaction())
+    {
+        query->setLastError(query->database().lastError());
+        return false;
+    }
+
+    QSqlQuery q = query->executeBatch(sql, columns, stats);
+    query->notifyWrite(query->tableName());
+    q.finish();
+
+    stats.m_rowCount = columns.last().count();
+    Query::reportStats(stats);
+
+    if (query->hasError())
+    {
+        const QSqlError error = query->lastError();
+        query->endTransaction(false);
+        query->setLastError(error);
+        return false;
+    }
+
+    if (!query->endTransaction(true))
+    {
+        query->setLastError(query->database().lastError());
+        return false;
+    }
 
-    QSqlQuery q = impl->m_query->performSQL(sql);
-    return q.numRowsAffected() > 0;
+    return true;
 }
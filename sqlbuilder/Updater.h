@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <QString>
+#include <QFuture>
 
 #include "Where.h"
 QT_FORWARD_DECLARE_CLASS(Query)
@@ -43,10 +44,71 @@ public:
      */
     bool perform() &&;
 
+    /*!
+     * \brief performAsync  -- executes the query on Query::asyncExecutor() thread pool, on that thread's own connection,
+     * so the caller is not blocked. The generator is consumed, the Query it was created by is not used anymore (it may be
+     * destroyed meanwhile), that also means the query is not a part of the caller's transaction.
+     * \return              -- future with success/failure of the query (affected rows > 0), it's result() throws QueryError on failure
+     */
+    QFuture<bool> performAsync() &&;
+
 private:
+    friend class Batch;
+
+    // generates the SQL with placeholders, filling the values to be bound
+    QString buildSQL(QVariantList& bindValues) const;
+
+    // the table being written, for cache invalidation
+    QString tableName() const;
+
     struct UpdaterPrivate;
     std::unique_ptr<UpdaterPrivate> impl;
 
     static const QString UPDATE_SQL;
 };
 
+/*******************************************************************************************/
+
+/*!
+ * \brief The UpdaterBatch class
+ * is an UPDATE generator for many rows, each of them is found by the key column
+ * and gets it's own values. The statement is prepared once, the values are bound as
+ * column arrays and executed by QSqlQuery::execBatch(), so the drivers with array
+ * binding send all the rows in one call, the others execute it row by row.
+ */
+class UpdaterBatch
+{
+    Q_DISABLE_COPY(UpdaterBatch)
+public:
+    /*!
+     * \brief UpdaterBatch  -- constructor of the generator, don't use it manually
+     * \param q             -- ptr to the Query class, that created it
+     * \param fields        -- columns of the rows' values, the key among them
+     * \param keyField      -- column in "WHERE key = ?"
+     */
+    UpdaterBatch(const Query* q, const QStringList& fields, const QString& keyField);
+    ~UpdaterBatch();
+
+    UpdaterBatch(UpdaterBatch&&);
+    UpdaterBatch& operator=(UpdaterBatch&&);
+
+    /*!
+     * \brief values    -- adds a row to be updated
+     * \param data      -- list of values, shoul match by count the number of fields
+     * \return          -- this generator as rvalue to be reused
+     */
+    UpdaterBatch values(const QVariantList& data) &&;
+
+    /*!
+     * \brief perform   -- executes the query for all the rows in one transaction
+     * \return          -- success/failure of the query (rows not found by the key are not a failure,
+     * rows of a wrong length are, nothing is updated then)
+     */
+    bool perform() &&;
+
+private:
+    struct UpdaterBatchPrivate;
+    std::unique_ptr<UpdaterBatchPrivate> impl;
+
+    static const QString UPDATE_BATCH_SQL;
+};
@@ -0,0 +1,161 @@
+#include "Upserter.h"
+#include "Query.h"
+#include "Config.h"
+#include "MultiRowInsert.h"
+#include "AsyncRunner.h"
+
+#include <QSqlDatabase>
+
+struct Upserter::UpserterPrivate
+{
+    UpserterPrivate(const Query* q, const QStringList& fields)
+        : m_query(q)
+        , m_fields(fields)
+        , m_doNothing(false)
+    {}
+
+    const Query*        m_query;
+    const QStringList   m_fields;
+
+    QStringList         m_conflictColumns;  // empty means the primary key (or any conflict with DO NOTHING)
+    QStringList         m_updateColumns;    // empty means all the fields except the conflict target
+    bool                m_doNothing;
+
+    QList<QVariantList> m_data;
+};
+
+/***************************************************************************************/
+
+const QString Upserter::UPSERT_SQL { "INSERT INTO %1 (%2) VALUES %3 ON CONFLICT %4 RETURNING %5;" };
+const QString Upserter::INSERT_OR_IGNORE_SQL { "INSERT OR IGNORE INTO %1 (%2) VALUES %3 RETURNING %4;" };
+const QString Upserter::DO_UPDATE_SQL { "(%1) DO UPDATE SET %2" };
+const QString Upserter::DO_NOTHING_SQL { "DO NOTHING" };
+
+Upserter::Upserter(const Query* q, const QStringList& fields)
+    : impl(new UpserterPrivate(q, fields))
+{ }
+
+Upserter::~Upserter()
+{ }
+
+Upserter::Upserter(Upserter &&) = default;
+
+Upserter Upserter::onConflict(const QStringList& columns) &&
+{
+    impl->m_conflictColumns = columns;
+    return std::move(*this);
+}
+
+Upserter Upserter::doUpdate(const QStringList& columns) &&
+{
+    impl->m_updateColumns = columns;
+    impl->m_doNothing = false;
+    return std::move(*this);
+}
+
+Upserter Upserter::doNothing() &&
+{
+    impl->m_updateColumns.clear();
+    impl->m_doNothing = true;
+    return std::move(*this);
+}
+
+Upserter Upserter::values(const QVariantList& data) &&
+{
+    impl->m_data.append(data);
+    return std::move(*this);
+}
+
+QList<int> Upserter::perform() &&
+{
+    const int chunkRows = qMax(1, Config::INSERT_CHUNK_VALUES / qMax(1, impl->m_fields.count()));
+
+    int taken = 0;
+    return MultiRowInsert::perform(impl->m_query, chunkRows, true
+                                   , [this, chunkRows, &taken]() {
+                                         const QList<QVariantList> chunk = impl->m_data.mid(taken, chunkRows);
+                                         taken += chunk.count();
+                                         return chunk;
+                                     }
+                                   , [this](const QList<QVariantList>& rows, QVariantList& bindValues) {
+                                         return buildSQL(rows, bindValues);
+                                     });
+}
+
+QFuture<QList<int>> Upserter::performAsync() &&
+{
+    const Query* origin = impl->m_query;
+    std::shared_ptr<Upserter> upserter = std::make_shared<Upserter>(std::move(*this));
+
+    return runAsync<QList<int>>(*origin, [upserter](const Query& query) {
+        upserter->impl->m_query = &query;
+        return std::move(*upserter).perform();
+    });
+}
+
+QString Upserter::tableName() const
+{
+    return impl->m_query->tableName();
+}
+
+QString Upserter::buildSQL(QVariantList& bindValues) const
+{
+    return buildSQL(impl->m_data, bindValues);
+}
+
+QString Upserter::buildSQL(const QList<QVariantList>& rows, QVariantList& bindValues) const
+{
+    const QString valueTail = MultiRowInsert::valuesSQL(rows, bindValues);
+
+    const Query* query = impl->m_query;
+
+    QStringList updateColumns = impl->m_updateColumns;
+    if (!impl->m_doNothing && updateColumns.isEmpty())
+    {
+        const QStringList target = impl->m_conflictColumns.isEmpty() ? QStringList({query->primaryKeyName()})
+                                                                     : impl->m_conflictColumns;
+        for (const QString& field : impl->m_fields)
+        {
+            if (!target.contains(field))
+                updateColumns << field;
+        }
+    }
+
+    // nothing is left to update, like when only the key is inserted
+    if (updateColumns.isEmpty())
+    {
+        if (impl->m_conflictColumns.isEmpty() && query->database().driverName() == "QSQLITE")
+        {
+            return Upserter::INSERT_OR_IGNORE_SQL
+                            .arg(query->tableName())
+                            .arg(impl->m_fields.join(','))
+                            .arg(valueTail)
+                            .arg(query->primaryKeyName());
+        }
+
+        const QString conflict = impl->m_conflictColumns.isEmpty()
+                ? Upserter::DO_NOTHING_SQL
+                : QString("(%1) %2").arg(impl->m_conflictColumns.join(','), Upserter::DO_NOTHING_SQL);
+
+        return Upserter::UPSERT_SQL
+                        .arg(query->tableName())
+                        .arg(impl->m_fields.join(','))
+                        .arg(valueTail)
+                        .arg(conflict)
+                        .arg(query->primaryKeyName());
+    }
+
+    QStringList setPart;
+    for (const QString& column : updateColumns)
+        setPart << QString("%1 = EXCLUDED.%1").arg(column);
+
+    const QString target = impl->m_conflictColumns.isEmpty() ? query->primaryKeyName()
+                                                             : impl->m_conflictColumns.join(',');
+
+    return Upserter::UPSERT_SQL
+                    .arg(query->tableName())
+                    .arg(impl->m_fields.join(','))
+                    .arg(valueTail)
+                    .arg(Upserter::DO_UPDATE_SQL.arg(target, setPart.join(',')))
+                    .arg(query->primaryKeyName());
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <memory>
+#include <QVariant>
+#include <QFuture>
+
+QT_FORWARD_DECLARE_CLASS(Query)
+
+/*!
+ * \brief The Upserter class
+ * is an "INSERT ... ON CONFLICT" query generator, inserts the rows or updates the ones,
+ * that already exist, in one statement instead of select-then-insert-or-update.
+ * By default the conflict target is the primary key and all the other inserted columns
+ * are updated from EXCLUDED. On SQLite "DO NOTHING" without a conflict target becomes
+ * "INSERT OR IGNORE", the rest is the same syntax (SQLite 3.24+).
+ * IMPORTANT: on PostgreSQL "DO UPDATE" fails if two rows of one statement hit the same
+ * existing row, remove such duplicates before.
+ */
+class Upserter
+{
+    Q_DISABLE_COPY(Upserter)
+public:
+    /*!
+     * \brief Upserter  -- constructor of the generator, don't use it manually
+     * \param q         -- ptr to the Query class, that created it
+     * \param fields    -- list of column names in INSERT INTO tbl (...)
+     */
+    Upserter(const Query* q, const QStringList& fields);
+    ~Upserter();
+
+    Upserter(Upserter&&);
+    Upserter& operator=(Upserter&&) = default;
+
+    /*!
+     * \brief onConflict    -- conflict target, columns of some unique index or constraint
+     * \param columns       -- column names in ON CONFLICT (...)
+     * \return              -- this generator as rvalue to be reused
+     */
+    Upserter onConflict(const QStringList& columns) &&;
+
+    /*!
+     * \brief doUpdate  -- columns to be updated from the conflicting rows, like "column = EXCLUDED.column"
+     * \param columns   -- column names, all the inserted ones except the conflict target if empty
+     * \return          -- this generator as rvalue to be reused
+     */
+    Upserter doUpdate(const QStringList& columns = QStringList()) &&;
+
+    /*!
+     * \brief doNothing -- conflicting rows are skipped, existing ones stay untouched
+     * \return          -- this generator as rvalue to be reused
+     */
+    Upserter doNothing() &&;
+
+    /*!
+     * \brief values    -- adds list of values to be inserted to the generator
+     * \param data      -- list of inserted values, shoul match by count the number of fields
+     * \return          -- this generator as rvalue to be reused
+     */
+    Upserter values(const QVariantList& data) &&;
+
+    /*!
+     * \brief perform   -- executes the query, split into chunks by Config::INSERT_CHUNK_VALUES in one transaction
+     * \return          -- list of inserted or updated records' ids (skipped ones are not returned) or empty list
+     * on failure, also check Query's hasError() if you want to ensure the result
+     */
+    QList<int> perform() &&;
+
+    /*!
+     * \brief performAsync  -- executes the query on Query::asyncExecutor() thread pool, on that thread's own connection,
+     * so the caller is not blocked. The generator is consumed, the Query it was created by is not used anymore (it may be
+     * destroyed meanwhile), that also means the query is not a part of the caller's transaction.
+     * \return              -- future with list of inserted or updated records' ids, it's result() throws QueryError on failure
+     */
+    QFuture<QList<int>> performAsync() &&;
+
+private:
+    friend class Batch;
+
+    // generates the SQL with placeholders, filling the values to be bound
+    QString buildSQL(QVariantList& bindValues) const;
+    QString buildSQL(const QList<QVariantList>& rows, QVariantList& bindValues) const;
+
+    // the table being written, for cache invalidation
+    QString tableName() const;
+
+    struct UpserterPrivate;
+    std::unique_ptr<UpserterPrivate> impl;
+
+    static const QString UPSERT_SQL;
+    static const QString INSERT_OR_IGNORE_SQL;
+    static const QString DO_UPDATE_SQL;
+    static const QString DO_NOTHING_SQL;
+};
@@ -1,32 +1,216 @@
 #include "Where.h"
 #include "Query.h"
+#include "SqlEscape.h"
+#include "Config.h"
 
 #include <QDateTime>
 
 namespace OP
 {
 
+Clause::Clause()
+    : m_root(-1)
+{ }
+
+Clause::Clause(const QString& field, const QString& op, const QString& value, const QVariantList& boundValues)
+    : m_root(0)
+    , m_boundValues(boundValues)
+{
+    m_nodes.append(Node{Node::PREDICATE, -1, -1, field, op, value, 0, boundValues.count(), false});
+}
+
+Clause Clause::list(const QString& field, bool negated, const QVariantList& values)
+{
+    Clause result(field, negated ? "NOT IN" : "IN", QString(), values);
+    result.m_nodes.first().m_list = true;
+    return result;
+}
+
 Clause Clause::operator!() &&
 {
-    m_sql = QString("NOT (%1)").arg(m_sql);
+    if (isEmpty())
+        return std::move(*this);
+
+    m_nodes.append(Node{Node::NOT, m_root, -1, QString(), QString(), QString(), 0, 0, false});
+    m_root = m_nodes.count() - 1;
     return std::move(*this);
 }
 
 Clause Clause::operator&&(Clause&& other) &&
 {
-    m_sql = QString("(%1) AND (%2)").arg(m_sql, other.m_sql);
+    if (other.isEmpty())
+        return std::move(*this);
+    if (isEmpty())
+        return std::move(other);
+
+    const int right = adopt(other);
+    m_nodes.append(Node{Node::AND, m_root, right, QString(), QString(), QString(), 0, 0, false});
+    m_root = m_nodes.count() - 1;
     return std::move(*this);
 }
 
 Clause Clause::operator||(Clause&& other) &&
 {
-    m_sql = QString("(%1) OR (%2)").arg(m_sql, other.m_sql);
+    if (other.isEmpty())
+        return std::move(*this);
+    if (isEmpty())
+        return std::move(other);
+
+    const int right = adopt(other);
+    m_nodes.append(Node{Node::OR, m_root, right, QString(), QString(), QString(), 0, 0, false});
+    m_root = m_nodes.count() - 1;
     return std::move(*this);
 }
 
+int Clause::adopt(const Clause& other)
+{
+    const int offset = m_nodes.count();
+    const int valueOffset = m_boundValues.count();
+
+    m_nodes.reserve(offset + other.m_nodes.count() + 1);
+    for (Node node : other.m_nodes)
+    {
+        if (node.m_left >= 0)
+            node.m_left += offset;
+        if (node.m_right >= 0)
+            node.m_right += offset;
+        node.m_firstValue += valueOffset;
+        m_nodes.append(std::move(node));
+    }
+    m_boundValues.append(other.m_boundValues);
+
+    return other.m_root + offset;
+}
+
 QString Clause::getSQl() &&
 {
-    return std::move(m_sql);
+    return toSQL();
+}
+
+QString Clause::toSQL(const ColumnResolver& resolver) const
+{
+    QString sql;
+    if (!isEmpty())
+        render(m_root, resolver, false, sql, nullptr);
+
+    return sql;
+}
+
+QString Clause::toSQL(QVariantList& bindValues, const ColumnResolver& resolver, bool arrayParameters) const
+{
+    QString sql;
+    if (!isEmpty())
+        render(m_root, resolver, arrayParameters, sql, &bindValues);
+
+    return sql;
+}
+
+void Clause::render(int index, const ColumnResolver& resolver, bool arrayParameters, QString& sql, QVariantList* bindValues) const
+{
+    const Node& node = m_nodes[index];
+
+    switch (node.m_kind)
+    {
+    case Node::PREDICATE:
+    {
+        const QString column = resolver ? resolver(node.m_field) : QString();
+        sql += column.isEmpty() ? QString("\"%1\"").arg(node.m_field) : column;
+
+        const QVariantList values = m_boundValues.mid(node.m_firstValue, node.m_valueCount);
+        if (!node.m_list)
+        {
+            sql += QLatin1Char(' ') + node.m_op + QLatin1Char(' ') + node.m_value;
+            if (bindValues)
+                bindValues->append(values);
+        }
+        else if (arrayParameters && node.m_valueCount >= Config::IN_ARRAY_THRESHOLD)
+        {
+            // one parameter, so the text & the plan don't depend on the list's length
+            sql += node.m_op == "IN" ? QLatin1String(" = ANY(?)") : QLatin1String(" != ALL(?)");
+            if (bindValues)
+                bindValues->append(arrayLiteral(values));
+        }
+        else
+        {
+            QString placeholders;
+            placeholders.reserve(2 * node.m_valueCount);
+            for (int i = 0; i < node.m_valueCount; ++i)
+                placeholders += i > 0 ? QLatin1String(",?") : QLatin1String("?");
+
+            sql += QLatin1Char(' ') + node.m_op + QLatin1String(" (") + placeholders + QLatin1Char(')');
+            if (bindValues)
+                bindValues->append(values);
+        }
+        break;
+    }
+
+    case Node::AND:
+    case Node::OR:
+        sql += QLatin1Char('(');
+        render(node.m_left, resolver, arrayParameters, sql, bindValues);
+        sql += node.m_kind == Node::AND ? QLatin1String(") AND (") : QLatin1String(") OR (");
+        render(node.m_right, resolver, arrayParameters, sql, bindValues);
+        sql += QLatin1Char(')');
+        break;
+
+    case Node::NOT:
+        sql += QLatin1String("NOT (");
+        render(node.m_left, resolver, arrayParameters, sql, bindValues);
+        sql += QLatin1Char(')');
+        break;
+    }
+}
+
+QString Clause::arrayLiteral(const QVariantList& values)
+{
+    QString result;
+    result.reserve(values.count() * 8 + 2);
+    result += QLatin1Char('{');
+
+    for (int i = 0; i < values.count(); ++i)
+    {
+        if (i > 0)
+            result += QLatin1Char(',');
+
+        const QVariant& value = values[i];
+        switch (value.type())
+        {
+        case QVariant::Int:
+        case QVariant::UInt:
+        case QVariant::LongLong:
+        case QVariant::ULongLong:
+        case QVariant::Double:
+        case QVariant::Bool:
+            result += value.isNull() ? QString("NULL") : value.toString();
+            break;
+
+        default:
+            if (value.isNull())
+            {
+                result += QLatin1String("NULL");
+                break;
+            }
+
+            // elements are double-quoted, backslashes & quotes inside are escaped
+            QString element = value.toString();
+            element.replace('\\', QString("\\\\"));
+            element.replace('"', QString("\\\""));
+            result += QLatin1Char('"') + element + QLatin1Char('"');
+        }
+    }
+
+    result += QLatin1Char('}');
+    return result;
+}
+
+bool Clause::isEmpty() const
+{
+    return m_root < 0;
+}
+
+const QVariantList& Clause::boundValues() const
+{
+    return m_boundValues;
 }
 
 QString Clause::escapeValue(const QVariant& value)
@@ -64,27 +248,14 @@ QString Clause::escapeValue(const QVariant& value)
 
     case QVariant::String:
     case QVariant::Char:
-        result = value.toString().trimmed().replace('\'', "''");
-        break;
+        return SqlEscape::quotedText(value.toString());
 
     case QVariant::Bool:
         result = QString::number(value.toBool());
         break;
 
     case QVariant::ByteArray:
-    {
-        static const char hexchars[] = "0123456789abcdef";
-        QString res;
-        QByteArray ba = value.toByteArray();
-        for (int i = 0; i < ba.size(); ++i)
-        {
-            uchar s = static_cast<uchar>(ba[i]);
-            res += QLatin1Char(hexchars[s >> 4]);
-            res += QLatin1Char(hexchars[s & 0x0f]);
-        }
-        result = res;
-        break;
-    }
+        return SqlEscape::quotedHex(value.toByteArray());
 
     default:
         result = value.toString();
@@ -95,46 +266,47 @@ QString Clause::escapeValue(const QVariant& value)
 
 Clause EQ(const QString& fieldName, const QVariant& value)
 {
-    return Clause{fieldName, "=", Clause::escapeValue(value.toString())};
+    return Clause{fieldName, "=", "?", {value.toString()}};
 }
 
 Clause NEQ(const QString& fieldName, const QVariant& value)
 {
-    return Clause{fieldName, "!=", Clause::escapeValue(value.toString())};
+    return Clause{fieldName, "!=", "?", {value.toString()}};
 }
 
 Clause LT(const QString& fieldName, const QVariant& value)
 {
-    return Clause{fieldName, "<", Clause::escapeValue(value.toString())};
+    return Clause{fieldName, "<", "?", {value.toString()}};
 }
 
 Clause GT(const QString& fieldName, const QVariant& value)
 {
-    return Clause{fieldName, ">", Clause::escapeValue(value.toString())};
+    return Clause{fieldName, ">", "?", {value.toString()}};
 }
 
 Clause LE(const QString& fieldName, const QVariant& value)
 {
-    return Clause{fieldName, "<=", Clause::escapeValue(value.toString())};
+    return Clause{fieldName, "<=", "?", {value.toString()}};
 }
 
 Clause GE(const QString& fieldName, const QVariant& value)
 {
-    return Clause{fieldName, ">=", Clause::escapeValue(value.toString())};
+    return Clause{fieldName, ">=", "?", {value.toString()}};
 }
 
 Clause IN(const QString& fieldName, const QVariantList& values)
 {
-    QStringList stringValues;
-    for (const QVariant& value : values)
-        stringValues << Clause::escapeValue(value);
+    return Clause::list(fieldName, false, values);
+}
 
-    return Clause{fieldName, "IN", QString("(%1)").arg(stringValues.join(','))};
+Clause NOT_IN(const QString& fieldName, const QVariantList& values)
+{
+    return Clause::list(fieldName, true, values);
 }
 
 Clause IS_NULL(const QString& fieldName)
 {
-    return Clause{fieldName, "IS", Clause::escapeValue(QVariant())};
+    return Clause{fieldName, "IS", "NULL"};
 }
 
 }
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <functional>
+#include <type_traits>
 #include <QString>
 #include <QVariant>
+#include <QVector>
+#include <QDateTime>
+#include <QUuid>
 
 /*!
  * Here goes a namespase of helpers that implement "WHERE ..." support
@@ -13,22 +18,33 @@ namespace OP
 /*!
  * \brief The Clause class
  * is an internal class, that translates C++ boolean logic into "WHERE ..." statements.
- * It optimizes nothing, no syntax tree parsing here, so don't abuse your queries with too much
- * of clauses. Executed clause is guaranteed to have the same interpretation when calculated by
+ * Clauses are kept as a small syntax tree: it's nodes live in the clause's own node pool (merged
+ * into the left operand's pool by &&, || and !), the SQL text is rendered once, when the generator
+ * is performed. Column names stay nodes until then, so generators can qualify them for JOINs.
+ * Executed clause is guaranteed to have the same interpretation when calculated by
  * database as you've written in your sources. Just using braces here =)
  */
 class Clause
 {
 public:
     /*!
-     * \brief Clause    -- is a constructor of smth like " col='val' "
-     * \param field     -- column name in the clause
-     * \param op        -- clause operation (=,>,<, IN, etc.)
-     * \param value     -- value in the clause
+     * \brief ColumnResolver -- maps a column name of the clause to it's SQL identifier, like "tbl"."col"
      */
-    Clause(const QString& field, const QString& op, const QString& value)
-        : m_sql(QString("\"%1\" %2 %3").arg(field, op, value))
-    { }
+    using ColumnResolver = std::function<QString(const QString&)>;
+
+    /*!
+     * \brief Clause    -- constructor of an empty clause, renders to nothing
+     */
+    Clause();
+
+    /*!
+     * \brief Clause        -- is a constructor of smth like " col=? "
+     * \param field         -- column name in the clause
+     * \param op            -- clause operation (=,>,<, IN, etc.)
+     * \param value         -- value part of the clause, SQL with positional "?" placeholders
+     * \param boundValues   -- values for the placeholders in the value part, in order
+     */
+    Clause(const QString& field, const QString& op, const QString& value, const QVariantList& boundValues = QVariantList());
 
     /*!
      * \brief operator ! -- is a SQL negation, uses "NOT (...)"
@@ -49,16 +65,45 @@ public:
     Clause operator||(Clause&& other) &&;
 
     /*!
-     * \brief getSQl    -- returns the curently generated SQL
+     * \brief getSQl    -- renders the SQL of the clause, columns are quoted like "col"
      * \return          -- string with the accumulated clause
      */
     QString getSQl() &&;
 
+    /*!
+     * \brief toSQL     -- renders the SQL of the clause
+     * \param resolver  -- gives the identifiers of the columns, "col" quoting is used for empty result or resolver
+     * \return          -- string with the accumulated clause, empty for an empty clause
+     */
+    QString toSQL(const ColumnResolver& resolver = ColumnResolver()) const;
+
+    /*!
+     * \brief toSQL             -- renders the SQL of the clause together with it's values, the way generators do
+     * \param bindValues        -- filled with the values for the placeholders, in order
+     * \param resolver          -- gives the identifiers of the columns, see above
+     * \param arrayParameters   -- IN/NOT_IN lists of Config::IN_ARRAY_THRESHOLD values or more are sent as one array
+     * parameter, "col = ANY(?)" / "col != ALL(?)", the server must support it (PostgreSQL)
+     * \return                  -- string with the accumulated clause, empty for an empty clause
+     */
+    QString toSQL(QVariantList& bindValues, const ColumnResolver& resolver, bool arrayParameters) const;
+
+    /*!
+     * \brief isEmpty   -- checks if the clause has no conditions
+     * \return          -- true for a default-constructed clause
+     */
+    bool isEmpty() const;
+
+    /*!
+     * \brief boundValues   -- returns values for the placeholders in the generated SQL, in order of their placeholders
+     * \return              -- list of values in order of their placeholders
+     */
+    const QVariantList& boundValues() const;
+
     /*!
      * \brief escapeValue   -- escapes values due to database rules. Honestly taken from
      * the QSqlDriver class (same idea, written in a more simple way). Has not been tested fully,
-     * the target was PostgreSQL, so binary data may not be supported by other DB engines. It's not
-     * only used by the clauses, also internally used in other generators.
+     * the target was PostgreSQL, so binary data may not be supported by other DB engines. The clauses
+     * and generators bind values as parameters, so it is only needed when values go into SQL text.
      * DB identifiers are just escaped like "id" everywhere through the code.
      * \param value         -- value to be escaped propely
      * \return              -- string represetnation of the value to be used
@@ -66,11 +111,51 @@ public:
     static QString escapeValue(const QVariant& value);
 
 private:
-    QString     m_sql;
+    struct Node
+    {
+        enum Kind
+        {
+            PREDICATE,  // "col" op value
+            AND,        // (left) AND (right)
+            OR,         // (left) OR (right)
+            NOT         // NOT (left)
+        };
+
+        Kind        m_kind;
+        int         m_left;     // child nodes' indexes in the pool
+        int         m_right;
+
+        QString     m_field;    // predicate parts
+        QString     m_op;
+        QString     m_value;
+
+        int         m_firstValue; // predicate's values in m_boundValues
+        int         m_valueCount;
+        bool        m_list;       // IN/NOT_IN, the value part is made when rendered
+    };
+
+    friend Clause IN(const QString& fieldName, const QVariantList& values);
+    friend Clause NOT_IN(const QString& fieldName, const QVariantList& values);
+
+    // "col IN (...)" list, that may become an array parameter
+    static Clause list(const QString& field, bool negated, const QVariantList& values);
+
+    // appends the other clause's nodes to the pool, returns the index of it's root here
+    int adopt(const Clause& other);
+    void render(int index, const ColumnResolver& resolver, bool arrayParameters, QString& sql, QVariantList* bindValues) const;
+
+    // PostgreSQL array literal of the values, like {1,2,"text"}
+    static QString arrayLiteral(const QVariantList& values);
+
+    QVector<Node>   m_nodes;
+    int             m_root;
+
+    // the operands' values are appended in the order of their SQL, so they are always the placeholders' order
+    QVariantList    m_boundValues;
 };
 
 /*!
- * \brief EQ        -- helper, that constructs " col='val' " clause part
+ * \brief EQ        -- helper, that constructs " col=? " clause part
  * \param fieldName -- column name
  * \param value     -- value to be used
  * \return          -- clause entity (see the above class)
@@ -78,7 +163,7 @@ private:
 Clause EQ(const QString& fieldName, const QVariant& value);
 
 /*!
- * \brief NEQ       -- helper, that constructs " col!='val' " clause part
+ * \brief NEQ       -- helper, that constructs " col!=? " clause part
  * \param fieldName -- column name
  * \param value     -- value to be used
  * \return          -- clause entity (see the above class)
@@ -86,7 +171,7 @@ Clause EQ(const QString& fieldName, const QVariant& value);
 Clause NEQ(const QString& fieldName, const QVariant& value);
 
 /*!
- * \brief LT        -- helper, that constructs " col<'val' " clause part
+ * \brief LT        -- helper, that constructs " col<? " clause part
  * \param fieldName -- column name
  * \param value     -- value to be used
  * \return          -- clause entity (see the above class)
@@ -94,7 +179,7 @@ Clause NEQ(const QString& fieldName, const QVariant& value);
 Clause LT(const QString& fieldName, const QVariant& value);
 
 /*!
- * \brief GT        -- helper, that constructs " col>'val' " clause part
+ * \brief GT        -- helper, that constructs " col>? " clause part
  * \param fieldName -- column name
  * \param value     -- value to be used
  * \return          -- clause entity (see the above class)
@@ -102,7 +187,7 @@ Clause LT(const QString& fieldName, const QVariant& value);
 Clause GT(const QString& fieldName, const QVariant& value);
 
 /*!
- * \brief LE        -- helper, that constructs " col<='val' " clause part
+ * \brief LE        -- helper, that constructs " col<=? " clause part
  * \param fieldName -- column name
  * \param value     -- value to be used
  * \return          -- clause entity (see the above class)
@@ -110,21 +195,137 @@ Clause GT(const QString& fieldName, const QVariant& value);
 Clause LE(const QString& fieldName, const QVariant& value);
 
 /*!
- * \brief GE        -- helper, that constructs " col>='val' " clause part
+ * \brief GE        -- helper, that constructs " col>=? " clause part
  * \param fieldName -- column name
  * \param value     -- value to be used
  * \return          -- clause entity (see the above class)
  */
 Clause GE(const QString& fieldName, const QVariant& value);
 
+//--------------------------- *** typed comparisons *** ----------------------------------//
+
+namespace Detail
+{
+    /*!
+     * \brief The Bound struct
+     * tells, how a C++ value is bound without going through QVariant::toString(): integers, floating point, bool,
+     * strings, dates & times keep their type. QUuid is bound as it's text, drivers don't agree on the uuid type.
+     * Other types are not "typed", the QVariant overloads are used for them.
+     */
+    template<typename T, typename Enable = void>
+    struct Bound
+    {
+        static constexpr bool typed = false;
+    };
+
+    template<typename T>
+    struct Bound<T, typename std::enable_if<std::is_integral<T>::value
+                                            && !std::is_same<T, bool>::value
+                                            && !std::is_same<T, char>::value>::type>
+    {
+        static constexpr bool typed = true;
+        static QVariant value(T v)
+        {
+            return sizeof(T) <= sizeof(int) && std::is_signed<T>::value
+                    ? QVariant(int(v))
+                    : std::is_signed<T>::value ? QVariant(qint64(v)) : QVariant(quint64(v));
+        }
+    };
+
+    template<typename T>
+    struct Bound<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+    {
+        static constexpr bool typed = true;
+        static QVariant value(T v) { return QVariant(double(v)); }
+    };
+
+#define SQLBUILDER_TYPED_BOUND(Type, ValueType, expression) \
+    template<> \
+    struct Bound<Type> \
+    { \
+        static constexpr bool typed = true; \
+        static QVariant value(ValueType v) { return QVariant(expression); } \
+    };
+
+    SQLBUILDER_TYPED_BOUND(bool, bool, v)
+    SQLBUILDER_TYPED_BOUND(QString, const QString&, v)
+    SQLBUILDER_TYPED_BOUND(const char*, const char*, QString::fromUtf8(v))
+    SQLBUILDER_TYPED_BOUND(char*, const char*, QString::fromUtf8(v))
+    SQLBUILDER_TYPED_BOUND(QDate, const QDate&, v)
+    SQLBUILDER_TYPED_BOUND(QTime, const QTime&, v)
+    SQLBUILDER_TYPED_BOUND(QDateTime, const QDateTime&, v)
+    SQLBUILDER_TYPED_BOUND(QUuid, const QUuid&, v.toString())
+
+#undef SQLBUILDER_TYPED_BOUND
+
+    template<typename T>
+    using BoundOf = Bound<typename std::decay<T>::type>;
+
+    template<typename T>
+    using TypedClause = typename std::enable_if<BoundOf<T>::typed, Clause>::type;
+}
+
+/*
+ * Typed overloads of the comparisons above: the value is bound with it's own type, so the server
+ * compares it as is, without casting text. The QVariant overloads are chosen for the other types.
+ */
+
+template<typename T>
+Detail::TypedClause<T> EQ(const QString& fieldName, const T& value)
+{
+    return Clause{fieldName, "=", "?", {Detail::BoundOf<T>::value(value)}};
+}
+
+template<typename T>
+Detail::TypedClause<T> NEQ(const QString& fieldName, const T& value)
+{
+    return Clause{fieldName, "!=", "?", {Detail::BoundOf<T>::value(value)}};
+}
+
+template<typename T>
+Detail::TypedClause<T> LT(const QString& fieldName, const T& value)
+{
+    return Clause{fieldName, "<", "?", {Detail::BoundOf<T>::value(value)}};
+}
+
+template<typename T>
+Detail::TypedClause<T> GT(const QString& fieldName, const T& value)
+{
+    return Clause{fieldName, ">", "?", {Detail::BoundOf<T>::value(value)}};
+}
+
+template<typename T>
+Detail::TypedClause<T> LE(const QString& fieldName, const T& value)
+{
+    return Clause{fieldName, "<=", "?", {Detail::BoundOf<T>::value(value)}};
+}
+
+template<typename T>
+Detail::TypedClause<T> GE(const QString& fieldName, const T& value)
+{
+    return Clause{fieldName, ">=", "?", {Detail::BoundOf<T>::value(value)}};
+}
+
+//---
+
 /*!
- * \brief IN        -- helper, that constructs "col IN ('val1', 'val2', ...)" clause part
+ * \brief IN        -- helper, that constructs "col IN (?, ?, ...)" clause part, long lists become
+ * one array parameter "col = ANY(?)" on PostgreSQL (see Config::IN_ARRAY_THRESHOLD)
  * \param fieldName -- column name
  * \param values    -- values to be used
  * \return          -- clause entity (see the above class)
  */
 Clause IN(const QString& fieldName, const QVariantList& values);
 
+/*!
+ * \brief NOT_IN    -- helper, that constructs "col NOT IN (?, ?, ...)" clause part, long lists become
+ * one array parameter "col != ALL(?)" on PostgreSQL (see Config::IN_ARRAY_THRESHOLD)
+ * \param fieldName -- column name
+ * \param values    -- values to be used
+ * \return          -- clause entity (see the above class)
+ */
+Clause NOT_IN(const QString& fieldName, const QVariantList& values);
+
 /*!
  * \brief EQ        -- helper, that constructs "col IS NULL" clause part
  * \param fieldName -- column name
@@ -1,6 +1,6 @@
 DESTDIR = $$PWD/../bin
 
-QT       += core sql
+QT       += core sql concurrent
 
 TARGET = sqlbuilder
 TEMPLATE = lib
@@ -8,20 +8,60 @@ CONFIG += staticlib c++11
 
 SOURCES += \
     Config.cpp \
+    ConnectionPool.cpp \
+    SchemaCache.cpp \
+    StatementCache.cpp \
+    ResultCache.cpp \
+    QueryStats.cpp \
     Query.cpp \
     Selector.cpp \
+    ColumnarResult.cpp \
     Where.cpp \
     Inserter.cpp \
+    Upserter.cpp \
     Deleter.cpp \
-    Updater.cpp
+    Updater.cpp \
+    MultiRowInsert.cpp \
+    SqlFormat.cpp \
+    SqlEscape.cpp \
+    SlowQueryLog.cpp \
+    PgNative.cpp \
+    Batch.cpp \
+    StaticQuery.cpp \
+    CopyInserter.cpp
 
 HEADERS += \
     Config.h \
+    ConnectionPool.h \
+    SchemaCache.h \
+    StatementCache.h \
+    ResultCache.h \
+    QueryError.h \
+    QueryStats.h \
+    AsyncRunner.h \
     Query.h \
     Selector.h \
+    ColumnarResult.h \
+    RowMapping.h \
     Where.h \
     Inserter.h \
+    Upserter.h \
     Deleter.h \
-    Updater.h
+    Updater.h \
+    MultiRowInsert.h \
+    SqlFormat.h \
+    SqlEscape.h \
+    SlowQueryLog.h \
+    PgNative.h \
+    Batch.h \
+    StaticQuery.h \
+    CopyInserter.h
 
 DEFINES *= QT_USE_QSTRINGBUILDER
+
+# optional native PostgreSQL client, enables single round trip batches
+packagesExist(libpq) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libpq
+    DEFINES += SQLBUILDER_LIBPQ
+}
@@ -1,17 +1,34 @@
-QT += sql
+QT += sql concurrent
 
 SQLBUILDER_DIR = $$PWD/sqlbuilder
 
 HEADERS += \
         $$SQLBUILDER_DIR/Config.h \
+        $$SQLBUILDER_DIR/ConnectionPool.h \
+        $$SQLBUILDER_DIR/SchemaCache.h \
+        $$SQLBUILDER_DIR/StatementCache.h \
+        $$SQLBUILDER_DIR/ResultCache.h \
+        $$SQLBUILDER_DIR/QueryError.h \
+        $$SQLBUILDER_DIR/QueryStats.h \
         $$SQLBUILDER_DIR/Query.h \
         $$SQLBUILDER_DIR/Where.h \
         $$SQLBUILDER_DIR/Selector.h \
+        $$SQLBUILDER_DIR/ColumnarResult.h \
+        $$SQLBUILDER_DIR/RowMapping.h \
         $$SQLBUILDER_DIR/Inserter.h \
-        $$SQLBUILDER_DIR/Deleter.h
+        $$SQLBUILDER_DIR/Upserter.h \
+        $$SQLBUILDER_DIR/Deleter.h \
+        $$SQLBUILDER_DIR/Batch.h \
+        $$SQLBUILDER_DIR/StaticQuery.h \
+        $$SQLBUILDER_DIR/CopyInserter.h
 
 INCLUDEPATH *= $$SQLBUILDER_DIR
 
+packagesExist(libpq) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libpq
+}
+
 LIBS += \
      -L$$DESTDIR \
      -lsqlbuilder
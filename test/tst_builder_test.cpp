@@ -7,14 +7,64 @@
 #include <QJsonDocument>
 #include <QDebug>
 #include <QUuid>
+#include <QFile>
+#include <QDir>
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
 
 #include "Config.h"
+#include "ConnectionPool.h"
+#include "SchemaCache.h"
+#include "ResultCache.h"
+#include "QueryError.h"
+#include "Batch.h"
+#include "StaticQuery.h"
+#include "CopyInserter.h"
 #include "Query.h"
 #include "Selector.h"
 #include "Inserter.h"
+#include "Upserter.h"
 #include "Deleter.h"
 #include "Updater.h"
 
+struct SomeObject
+{
+    int         _id;
+    int         _otype;
+    QString     name;
+    QVariant    descr;
+};
+SQLBUILDER_ROW(SomeObject, _id, _otype, name, descr)
+
+SQLBUILDER_TABLE(SomeObjectTable, "some_object", "_id")
+SQLBUILDER_COLUMN(SomeObjectId, "_id", int)
+SQLBUILDER_COLUMN(SomeObjectType, "_otype", int)
+SQLBUILDER_COLUMN(SomeObjectGuid, "guid", QString)
+SQLBUILDER_COLUMN(SomeObjectName, "name", QString)
+
+// escapeValue() as it used to be, the reference & the baseline of the benchmark
+static QString legacyEscapeValue(const QVariant& value)
+{
+    if (value.type() == QVariant::ByteArray)
+    {
+        static const char hexchars[] = "0123456789abcdef";
+        QString res;
+        QByteArray ba = value.toByteArray();
+        for (int i = 0; i < ba.size(); ++i)
+        {
+            uchar s = static_cast<uchar>(ba[i]);
+            res += QLatin1Char(hexchars[s >> 4]);
+            res += QLatin1Char(hexchars[s & 0x0f]);
+        }
+        return QString("'%1'").arg(res);
+    }
+
+    return QString("'%1'").arg(value.toString().trimmed().replace('\'', "''"));
+}
+
 class builder_test : public QObject
 {
     Q_OBJECT
@@ -63,6 +113,34 @@ private slots:
     void test_join_complex();
     void test_multiple_joins();
 
+    void test_connection_pool();
+    void test_schema_cache();
+    void test_connection_lifetime();
+    void test_bind_values();
+    void test_async_perform();
+    void test_batch();
+    void test_query_stats();
+    void test_slow_query_log();
+    void test_stream();
+    void test_columnar();
+    void test_row_mapping();
+    void test_cursor();
+    void test_keyset_pagination();
+    void test_result_cache();
+    void test_parallel_select();
+    void test_aggregates();
+    void test_clause_tree();
+    void test_static_query();
+    void test_escape_value();
+    void bench_escape_value_data();
+    void bench_escape_value();
+    void test_typed_clauses();
+    void test_in_arrays();
+    void test_copy_in();
+    void test_chunked_insert();
+    void test_upsert();
+    void test_exec_batch();
+
 private:
     bool            m_showDebug;
 
@@ -849,6 +927,1194 @@ void builder_test::test_multiple_joins()
     Q_ASSERT(!third_query.hasError());
 }
 
+void builder_test::test_connection_pool()
+{
+    const int THREAD_COUNT = qMax(2, Config::POOL_SIZE * 2);
+    std::atomic<int> failures { 0 };
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < THREAD_COUNT; ++t)
+    {
+        workers.emplace_back([&]{
+            for (int i = 0; i < 10; ++i)
+            {
+                const auto query = Query(TARGET_TABLE);
+                auto res = query.select({"_id"}).limit(1).perform();
+                if (query.hasError() || res.isEmpty())
+                    ++failures;
+            }
+        });
+    }
+
+    for (auto& worker : workers)
+        worker.join();
+
+    Q_ASSERT(failures == 0);
+    Q_ASSERT(ConnectionPool::size() <= Config::POOL_SIZE);
+
+    // an idle connection of a living thread is not closed by others, but by it's owner on return
+    std::atomic<bool> ready { false };
+    std::atomic<bool> cleared { false };
+    std::thread owner([&]{
+        Query(TARGET_TABLE).select({"_id"}).limit(1).perform();
+        ready = true;
+        while (!cleared)
+            QThread::msleep(1);
+
+        const auto again = Query(TARGET_TABLE);
+        again.select({"_id"}).limit(1).perform();
+        if (again.hasError())
+            ++failures;
+    });
+
+    while (!ready)
+        QThread::msleep(1);
+    ConnectionPool::clear();
+    Q_ASSERT(ConnectionPool::size() >= 1);
+
+    cleared = true;
+    owner.join();
+    Q_ASSERT(failures == 0);
+
+    // same thread -- same connection, so a nested Query sees the open transaction
+    auto query = Query(TARGET_TABLE);
+    bool ok = query.transact([&]{
+        auto ids = query
+                .insert({"_otype", "guid", "name"})
+                .values({55, QUuid::createUuid().toString(), "POOL_TEST"})
+                .perform();
+        Q_ASSERT(ids.count() == 1);
+
+        auto check = Query(TARGET_TABLE).select({"_id"}).where(OP::EQ("_id", ids.first())).perform();
+        Q_ASSERT(check.count() == 1);
+    });
+    Q_ASSERT(ok);
+}
+
+void builder_test::test_schema_cache()
+{
+    const auto query = Query(SECOND_TABLE);
+    Q_ASSERT(query.primaryKeyName() == "_id");
+
+    auto cached = SchemaCache::tableInfo(QSqlDatabase(), SECOND_TABLE); // no connection needed on cache hit
+    Q_ASSERT(cached.m_columnNames == query.columnNames());
+    Q_ASSERT(cached.m_primaryKey == "_id");
+
+    SchemaCache::invalidate(SECOND_TABLE);
+    Q_ASSERT(SchemaCache::tableInfo(QSqlDatabase(), SECOND_TABLE).m_columnNames.isEmpty());
+
+    auto columns = Query().tableColumnNames(SECOND_TABLE);
+    Q_ASSERT(columns == cached.m_columnNames);
+
+    // entries of one database are not served for another one
+    SchemaCache::TableInfo info;
+    Q_ASSERT(SchemaCache::cachedTableInfo(SECOND_TABLE, info));
+    const QString dbName = Config::DBNAME;
+    Config::DBNAME = dbName + "_other";
+    Q_ASSERT(!SchemaCache::cachedTableInfo(SECOND_TABLE, info));
+    Config::DBNAME = dbName;
+    Q_ASSERT(SchemaCache::cachedTableInfo(SECOND_TABLE, info));
+
+    // missing tables are not cached
+    Q_ASSERT(Query("no_table").columnNames().isEmpty());
+    Q_ASSERT(SchemaCache::tableInfo(QSqlDatabase(), "no_table").m_columnNames.isEmpty());
+}
+
+void builder_test::test_connection_lifetime()
+{
+    const auto query = Query(TARGET_TABLE);
+    query.select({"_id"}).limit(1).perform();
+    Q_ASSERT(!query.hasError());
+
+    // short-lived queries of the same thread must neither reconnect nor break the living one
+    for (int i = 0; i < 10; ++i)
+        Query(TARGET_TABLE).select({"_id"}).limit(1).perform();
+
+    query.select({"_id"}).limit(1).perform();
+    Q_ASSERT(!query.hasError());
+
+    // idle connections are dropped after the timeout, the next Query reconnects
+    const int idleMsecs = Config::POOL_IDLE_MSECS;
+    Config::POOL_IDLE_MSECS = 1;
+    {
+        std::thread([&]{
+            const auto other = Query(TARGET_TABLE);
+            other.select({"_id"}).limit(1).perform();
+            Q_ASSERT(!other.hasError());
+        }).join();
+    }
+    QThread::msleep(10);
+
+    const auto fresh = Query(TARGET_TABLE);
+    fresh.select({"_id"}).limit(1).perform();
+    Q_ASSERT(!fresh.hasError());
+    Q_ASSERT(ConnectionPool::size() == 1);
+
+    // a living thread with an event loop closes it's idle connection itself, not on the next acquire()
+    Config::POOL_IDLE_MSECS = 50;
+    QThread looping;
+    looping.start();
+    {
+        QObject context;
+        context.moveToThread(&looping);
+        QMetaObject::invokeMethod(&context, [&]{
+            const auto other = Query(TARGET_TABLE);
+            other.select({"_id"}).limit(1).perform();
+            Q_ASSERT(!other.hasError());
+        }, Qt::BlockingQueuedConnection);
+        Q_ASSERT(ConnectionPool::size() == 2);
+
+        QThread::msleep(300);
+        Q_ASSERT(ConnectionPool::size() == 1);
+    }
+    looping.quit();
+    looping.wait();
+
+    Config::POOL_IDLE_MSECS = idleMsecs;
+}
+
+void builder_test::test_bind_values()
+{
+    const auto query = Query(TARGET_TABLE);
+
+    // values are bound, not pasted into the SQL text
+    const QString TRICKY_NAME {"O'Reilly ? $1 -- \\ \" );"};
+
+    auto ids = query
+            .insert({"_otype", "guid", "name"})
+            .values({88, QUuid::createUuid().toString(), TRICKY_NAME})
+            .perform();
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(ids.count() == 1);
+
+    // same statement shape again and again -- prepared once, reused from the cache
+    for (int i = 0; i < 3; ++i)
+    {
+        auto res = query.select({"_id", "name"}).where(OP::EQ("name", TRICKY_NAME) && OP::EQ("_otype", 88)).perform();
+        Q_ASSERT(!query.hasError());
+        Q_ASSERT(res.count() == 1);
+        Q_ASSERT(res.first().toMap()["name"].toString() == TRICKY_NAME);
+    }
+
+    // raw SQL with values is cached too, but stays scrollable
+    QSqlQuery raw = query.performSQL(QString("SELECT _id FROM %1 WHERE name = ?;").arg(TARGET_TABLE), {TRICKY_NAME});
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(raw.seek(0) && raw.value(0).toInt() == ids.first());
+    Q_ASSERT(!raw.previous() && raw.seek(0));
+    raw.finish();
+
+    // statements differing by whitespace in a literal only are different statements
+    for (const QString& literal : {QString("a  b"), QString("a b")})
+    {
+        QSqlQuery spaced = query.performSQL(QString("SELECT '%1' WHERE ? = 1;").arg(literal), {1});
+        Q_ASSERT(spaced.next() && spaced.value(0).toString() == literal);
+        spaced.finish();
+    }
+
+    bool ok = query.update({{"descr", TRICKY_NAME}}).where(OP::IN("_id", {ids.first()})).perform();
+    Q_ASSERT(ok);
+    Q_ASSERT(!query.hasError());
+
+    ok = query.delete_(OP::EQ("descr", TRICKY_NAME)).perform();
+    Q_ASSERT(ok);
+    Q_ASSERT(!query.hasError());
+}
+
+void builder_test::test_async_perform()
+{
+    QFuture<QList<int>> idsFuture = Query(TARGET_TABLE)
+            .insert({"_otype", "guid", "name"})
+            .values({99, QUuid::createUuid().toString(), "ASYNC_TEST"})
+            .values({99, QUuid::createUuid().toString(), "ASYNC_TEST"})
+            .performAsync(); // the Query is gone already, that's fine
+
+    const QList<int> ids = idsFuture.result();
+    Q_ASSERT(ids.count() == 2);
+
+    QList<QFuture<QVariantList>> selects;
+    for (int i = 0; i < 8; ++i)
+        selects << Query(TARGET_TABLE).select({"_id", "name"}).where(OP::EQ("name", "ASYNC_TEST")).performAsync();
+
+    for (auto& future : selects)
+        Q_ASSERT(future.result().count() == 2);
+
+    QVariantList idData;
+    for (const int& id : ids)
+        idData << id;
+
+    bool ok = Query(TARGET_TABLE).update({{"descr", "ASYNC_DESCR"}}).where(OP::IN("_id", idData)).performAsync().result();
+    Q_ASSERT(ok);
+
+    ok = Query(TARGET_TABLE).delete_(OP::IN("_id", idData)).performAsync().result();
+    Q_ASSERT(ok);
+
+    // errors come with the result
+    bool thrown = false;
+    try
+    {
+        Query("no_table").select().performAsync().result();
+    }
+    catch (const QueryError& e)
+    {
+        thrown = e.error().isValid();
+        if (m_showDebug)
+            qInfo() << e.what();
+    }
+    Q_ASSERT(thrown);
+
+    // idle workers keep their connections, but never all of the pool, this thread still gets one at once
+    QList<QFuture<QVariantList>> workers;
+    for (int i = 0; i < 2 * Config::POOL_SIZE; ++i)
+        workers << Query(TARGET_TABLE).select({"_id"}).limit(1).performAsync();
+
+    for (auto& future : workers)
+        future.waitForFinished();
+
+    QElapsedTimer timer;
+    timer.start();
+    const auto query = Query(SECOND_TABLE);
+    query.select().count();
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(timer.elapsed() < Config::POOL_WAIT_MSECS / 2);
+}
+
+void builder_test::test_batch()
+{
+    const auto query = Query(TARGET_TABLE);
+    const QString BATCH_NAME {"BATCH_TEST's"};
+    const QString BATCH_DESCR {" BATCH \\ DESCR's\t"}; // inlined literals keep spaces & backslashes
+
+    auto results = query.batch()
+            .add(query.insert({"_otype", "guid", "name"})
+                 .values({77, QUuid::createUuid().toString(), BATCH_NAME})
+                 .values({77, QUuid::createUuid().toString(), BATCH_NAME}))
+            .add(query.update({{"descr", BATCH_DESCR}}).where(OP::EQ("name", BATCH_NAME)))
+            .add(query.select({"_id", "descr"}).where(OP::EQ("name", BATCH_NAME)))
+            .add(Query(SECOND_TABLE).select({"_id"}).limit(1))
+            .perform();
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(results.count() == 4);
+
+    Q_ASSERT(results[0].m_kind == BatchResult::Insert);
+    Q_ASSERT(results[0].m_ids.count() == 2);
+    Q_ASSERT(results[1].m_ok);
+    Q_ASSERT(results[2].m_rows.count() == 2);
+    Q_ASSERT(results[2].m_rows.first().toMap()["descr"].toString() == BATCH_DESCR);
+    Q_ASSERT(!results[3].m_error.isValid());
+
+    if (m_showDebug)
+        qInfo() << results[2].m_rows;
+
+    // a failing statement is reported in it's own result
+    results = query.batch()
+            .add(query.delete_(OP::EQ("name", BATCH_NAME)))
+            .add(Query(TARGET_TABLE).select({"no_such_column"}))
+            .perform();
+    Q_ASSERT(results.count() == 2);
+    Q_ASSERT(results[1].m_error.isValid());
+    Q_ASSERT(query.hasError());
+
+    // a statement reported as done has really taken effect, a rolled back one has an error
+    Q_ASSERT(results[0].m_ok != results[0].m_error.isValid());
+    Q_ASSERT(!results[0].m_ok || query.select().where(OP::EQ("name", BATCH_NAME)).perform().isEmpty());
+    Q_ASSERT(results[0].m_ok || query.select().where(OP::EQ("name", BATCH_NAME)).count() == 2);
+
+    // batch could have been cancelled atomically, clean up anyway
+    bool ok = query.delete_(OP::EQ("name", BATCH_NAME)).perform();
+    Q_ASSERT(ok || results[0].m_ok);
+    Q_ASSERT(query.select().where(OP::EQ("name", BATCH_NAME)).perform().isEmpty());
+}
+
+void builder_test::test_query_stats()
+{
+    QList<QueryStats> collected;
+    Query::setStatsHandler([&collected](const QueryStats& stats) {
+        collected.append(stats);
+    });
+
+    const auto query = Query(TARGET_TABLE);
+    auto res = query.select({"_id", "name"}).limit(5).perform();
+    Q_ASSERT(!query.hasError());
+
+    Q_ASSERT(collected.count() == 1);
+    const QueryStats& selectStats = collected.first();
+    Q_ASSERT(selectStats.m_sql.startsWith("SELECT"));
+    Q_ASSERT(selectStats.m_generationNsecs > 0);
+    Q_ASSERT(selectStats.m_executionNsecs > 0);
+    Q_ASSERT(selectStats.m_rowCount == res.count());
+    Q_ASSERT(res.isEmpty() || (selectStats.m_materializationNsecs > 0 && selectStats.m_resultBytes > 0));
+
+    if (m_showDebug)
+        qInfo() << selectStats.m_generationNsecs << selectStats.m_executionNsecs
+                << selectStats.m_fetchNsecs << selectStats.m_materializationNsecs << selectStats.m_resultBytes;
+
+    // raw SQL is reported as well, without the generation phase
+    query.performSQL(QString("SELECT COUNT(*) FROM %1").arg(TARGET_TABLE));
+    Q_ASSERT(collected.count() == 2);
+    Q_ASSERT(collected.last().m_generationNsecs == 0);
+    Q_ASSERT(collected.last().m_executionNsecs > 0);
+
+    Query::setStatsHandler(nullptr);
+    query.select().limit(1).perform();
+    Q_ASSERT(collected.count() == 2);
+}
+
+void builder_test::test_slow_query_log()
+{
+    const QString logPath = QDir::temp().filePath("sqlbuilder_slow_test.log");
+    QFile::remove(logPath);
+    QFile::remove(logPath + ".1");
+
+    const auto readLog = [&logPath]() -> QString {
+        // plans are captured in background, so give it some time
+        for (int i = 0; i < 100; ++i)
+        {
+            QFile file(logPath);
+            if (file.open(QIODevice::ReadOnly) && file.size() > 0)
+                return QString::fromUtf8(file.readAll());
+            QThread::msleep(20);
+        }
+        return QString();
+    };
+
+    Query::setSlowQueryLogging(30, logPath);
+
+    auto query = Query(TARGET_TABLE);
+    query.setTag("SLOW_TEST_TAG");
+
+    query.select({"_id"}).where(OP::EQ("_otype", 1)).limit(1).perform(); // fast, not logged
+    query.performSQL("SELECT pg_sleep(0.1);");
+    Q_ASSERT(!query.hasError());
+
+    const QString log = readLog();
+    Q_ASSERT(log.contains("SLOW_TEST_TAG"));
+    Q_ASSERT(log.contains("pg_sleep"));
+    Q_ASSERT(log.contains("plan:"));
+    Q_ASSERT(!log.contains("_otype"));
+
+    if (m_showDebug)
+        qInfo().noquote() << log;
+
+    // the log rotates instead of growing forever
+    const int maxBytes = Config::SLOW_LOG_MAX_BYTES;
+    Config::SLOW_LOG_MAX_BYTES = 1;
+
+    query.performSQL("SELECT pg_sleep(0.1);");
+    QThread::msleep(200);
+    Q_ASSERT(QFile::exists(logPath + ".1"));
+    Q_ASSERT(!readLog().isEmpty());
+
+    // with no room for pending plans the statement is still logged, but not explained
+    const int maxPending = Config::SLOW_LOG_MAX_PENDING;
+    Config::SLOW_LOG_MAX_PENDING = 0;
+    QThread::msleep(300);
+
+    query.performSQL("SELECT pg_sleep(0.1);");
+    Q_ASSERT(readLog().contains("too many plans pending"));
+
+    Config::SLOW_LOG_MAX_PENDING = maxPending;
+    Config::SLOW_LOG_MAX_BYTES = maxBytes;
+    Query::setSlowQueryLogging(0, QString());
+}
+
+void builder_test::test_stream()
+{
+    const auto query = Query(TARGET_TABLE);
+    const auto all = query.select({"_id", "name"}).orderBy("_id", Order::ASC).perform();
+    Q_ASSERT(!query.hasError());
+
+    QVariantList streamed;
+    int count = query.select({"_id", "name"}).orderBy("_id", Order::ASC).stream([&streamed](const QVariantMap& row) {
+        streamed.append(row);
+        return true;
+    });
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(count == all.count());
+    Q_ASSERT(streamed == all);
+
+    // early termination leaves the connection usable
+    count = query.select({"_id"}).stream([](const QVariantMap& row) {
+        return row["_id"].isNull(); // stops on the first row
+    });
+    Q_ASSERT(count == qMin(1, all.count()));
+
+    Q_ASSERT(query.select({"_id"}).perform().count() == all.count());
+    Q_ASSERT(!query.hasError());
+}
+
+void builder_test::test_columnar()
+{
+    const auto query = Query(TARGET_TABLE);
+    const auto rows = query.select({"_id", "name", "descr"}).orderBy("_id", Order::ASC).limit(50).perform();
+    Q_ASSERT(!query.hasError());
+
+    const ColumnarResult columns = query.select({"_id", "name", "descr"}).orderBy("_id", Order::ASC).limit(50).performColumnar();
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(columns.rowCount() == rows.count());
+    Q_ASSERT(columns.columnCount() == 3);
+
+    const int idColumn = columns.columnIndex("_id");
+    const int descrColumn = columns.columnIndex("descr");
+    Q_ASSERT(columns.columnType(idColumn) == ColumnarResult::Integer);
+    Q_ASSERT(columns.integers(idColumn).count() == rows.count());
+    Q_ASSERT(columns.nulls(descrColumn).size() == rows.count());
+    Q_ASSERT(columns.columnIndex("no_column") == -1);
+
+    for (int i = 0; i < rows.count(); ++i)
+    {
+        const QVariantMap row = rows[i].toMap();
+        Q_ASSERT(columns.integers(idColumn)[i] == row["_id"].toLongLong());
+        Q_ASSERT(columns.isNull(i, descrColumn) == row["descr"].isNull());
+        Q_ASSERT(columns.row(i)["name"].toString() == row["name"].toString());
+    }
+}
+
+void builder_test::test_row_mapping()
+{
+    Q_ASSERT(RowMapping<SomeObject>::columns() == QStringList({"_id", "_otype", "name", "descr"}));
+
+    const auto query = Query(TARGET_TABLE);
+    const auto rows = query.select().orderBy("_id", Order::ASC).limit(50).perform();
+    Q_ASSERT(!query.hasError());
+
+    const QVector<SomeObject> objects = query.select().orderBy("_id", Order::ASC).limit(50).perform<SomeObject>();
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(objects.count() == rows.count());
+
+    for (int i = 0; i < objects.count(); ++i)
+    {
+        const QVariantMap row = rows[i].toMap();
+        Q_ASSERT(objects[i]._id == row["_id"].toInt());
+        Q_ASSERT(objects[i]._otype == row["_otype"].toInt());
+        Q_ASSERT(objects[i].name == row["name"].toString());
+        Q_ASSERT(objects[i].descr.isNull() == row["descr"].isNull());
+    }
+
+    // explicitly selected fields work too, the missing ones are value-initialized
+    const QVector<SomeObject> partial = query.select({"_id", "name"}).limit(1).perform<SomeObject>();
+    Q_ASSERT(partial.count() == qMin(1, rows.count()));
+}
+
+void builder_test::test_cursor()
+{
+    const auto query = Query(TARGET_TABLE);
+    const auto all = query.select({"_id", "name"}).orderBy("_id", Order::ASC).perform();
+    Q_ASSERT(!query.hasError());
+
+    // several chunks of 3 rows
+    QVariantList streamed;
+    int count = query.select({"_id", "name"}).orderBy("_id", Order::ASC).cursor(3).stream([&streamed](const QVariantMap& row) {
+        streamed.append(row);
+        return true;
+    });
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(count == all.count());
+    Q_ASSERT(streamed == all);
+
+    auto performed = query.select({"_id", "name"}).where(OP::GE("_id", 0)).orderBy("_id", Order::ASC).cursor(2).perform();
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(performed == all);
+
+    // early termination closes the cursor and it's transaction
+    count = query.select({"_id"}).cursor(2).stream([](const QVariantMap&) {
+        return false;
+    });
+    Q_ASSERT(count == qMin(1, all.count()));
+    Q_ASSERT(!query.hasError());
+
+    // inside a transaction the cursor joins it, the outer rollback still works
+    const QString CURSOR_NAME {"CURSOR_TEST"};
+    bool ok = query.transact([&]{
+        query.insert({"_otype", "guid", "name"}).values({44, QUuid::createUuid().toString(), CURSOR_NAME}).perform();
+
+        auto inside = query.select({"_id"}).where(OP::EQ("name", CURSOR_NAME)).cursor(10).perform();
+        Q_ASSERT(inside.count() == 1);
+
+        query.performSQL("SELECT no_such_function();"); // fails, so everything is rolled back
+    });
+    Q_ASSERT(!ok);
+    Q_ASSERT(query.select().where(OP::EQ("name", CURSOR_NAME)).perform().isEmpty());
+
+    // a throwing handler ends the cursor's transaction, the next one is committed on it's own
+    bool thrown = false;
+    try
+    {
+        query.select({"_id"}).cursor(2).stream([](const QVariantMap&) -> bool {
+            throw std::runtime_error("handler failure");
+        });
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    Q_ASSERT(thrown || all.isEmpty());
+
+    ok = query.transact([&]{
+        query.insert({"_otype", "guid", "name"}).values({44, QUuid::createUuid().toString(), CURSOR_NAME}).perform();
+    });
+    Q_ASSERT(ok);
+    Q_ASSERT(query.select().where(OP::EQ("name", CURSOR_NAME)).performAsync().result().count() == 1); // other connection
+    Q_ASSERT(Query(TARGET_TABLE).delete_(OP::EQ("name", CURSOR_NAME)).perform());
+}
+
+void builder_test::test_keyset_pagination()
+{
+    const auto query = Query(TARGET_TABLE);
+    const auto all = query.select({"_id", "_otype", "name"}).orderBy({"_otype", "_id"}, Order::ASC).perform();
+    Q_ASSERT(!query.hasError());
+
+    QVariantList paged;
+    QString token;
+    int pages = 0;
+    do
+    {
+        KeysetPage page = query
+                .select({"_id", "_otype", "name"})
+                .orderBy({"_otype", "_id"}, Order::ASC)
+                .seek(token)
+                .limit(3)
+                .performPage();
+        Q_ASSERT(!query.hasError());
+
+        paged << page.m_rows;
+        token = page.m_nextToken;
+        ++pages;
+    }
+    while (!token.isEmpty() && pages < 1000);
+    Q_ASSERT(paged == all);
+
+    // no order: the primary key is the keyset, from the first page on
+    const auto byKey = query.select({"_id", "name"}).orderBy("_id", Order::ASC).perform();
+    paged.clear();
+    pages = 0;
+    do
+    {
+        KeysetPage page = query.select({"_id", "name"}).seek(token).limit(3).performPage();
+        Q_ASSERT(!query.hasError());
+
+        paged << page.m_rows;
+        token = page.m_nextToken;
+        ++pages;
+    }
+    while (!token.isEmpty() && pages < 1000);
+    Q_ASSERT(paged == byKey);
+
+    // a non-unique order column gets the primary key as the tie-breaker, rows of equal values are not skipped
+    const auto byType = query.select({"_id", "_otype"}).orderBy({"_otype", "_id"}, Order::DESC).perform();
+    paged.clear();
+    pages = 0;
+    do
+    {
+        KeysetPage page = query.select({"_id", "_otype"}).orderBy("_otype", Order::DESC).seek(token).limit(2).performPage();
+        Q_ASSERT(!query.hasError());
+
+        paged << page.m_rows;
+        token = page.m_nextToken;
+        ++pages;
+    }
+    while (!token.isEmpty() && pages < 1000);
+    Q_ASSERT(paged == byType);
+
+    // descending by primary key, explicit values instead of a token
+    const auto desc = query.select({"_id"}).orderBy("_id", Order::DESC).limit(2).perform();
+    if (desc.count() == 2)
+    {
+        const auto next = query
+                .select({"_id"})
+                .orderBy("_id", Order::DESC)
+                .after({desc.first().toMap()["_id"]})
+                .limit(1)
+                .perform();
+        Q_ASSERT(!query.hasError());
+        Q_ASSERT(next.first().toMap()["_id"] == desc.last().toMap()["_id"]);
+    }
+
+    // the values must match the keyset: the order columns plus the primary key
+    Q_ASSERT(query.select({"_id"}).orderBy("_otype", Order::ASC).after({1}).perform().isEmpty());
+    Q_ASSERT(query.hasError());
+
+    // broken tokens don't restart from the beginning
+    KeysetPage broken = query.select().seek("not a token").limit(3).performPage();
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(broken.m_rows.isEmpty());
+    Q_ASSERT(broken.m_nextToken.isEmpty());
+}
+
+void builder_test::test_result_cache()
+{
+    ResultCache::invalidateAll();
+    ResultCache::resetCounters();
+
+    const auto query = Query(TARGET_TABLE);
+    const QString CACHE_NAME {"CACHE_TEST"};
+
+    auto first = query.select({"_id", "name"}).where(OP::EQ("_otype", 55)).cached().perform();
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(ResultCache::misses() == 1 && ResultCache::hits() == 0);
+
+    auto second = query.select({"_id", "name"}).where(OP::EQ("_otype", 55)).cached().perform();
+    Q_ASSERT(ResultCache::hits() == 1);
+    Q_ASSERT(second == first);
+
+    // other values -- other entry
+    query.select({"_id", "name"}).where(OP::EQ("_otype", 56)).cached().perform();
+    Q_ASSERT(ResultCache::misses() == 2);
+    Q_ASSERT(ResultCache::size() == 2);
+
+    // writes of the generators invalidate the table's results
+    query.insert({"_otype", "guid", "name"}).values({55, QUuid::createUuid().toString(), CACHE_NAME}).perform();
+    Q_ASSERT(ResultCache::size() == 0);
+
+    auto third = query.select({"_id", "name"}).where(OP::EQ("_otype", 55)).cached().perform();
+    Q_ASSERT(ResultCache::misses() == 3);
+    Q_ASSERT(third.count() == first.count() + 1);
+
+    // so do the writes of the joined tables
+    const auto second_query = Query(SECOND_TABLE);
+    second_query.select({"some_text", "name"}).join(TARGET_TABLE, {"some_fkey", "_id"}, Join::INNER).cached().perform();
+    Q_ASSERT(!second_query.hasError());
+    Q_ASSERT(ResultCache::size() == 2);
+
+    bool ok = query.delete_(OP::EQ("name", CACHE_NAME)).perform();
+    Q_ASSERT(ok);
+    Q_ASSERT(ResultCache::size() == 0);
+
+    // uncommitted data is never cached
+    query.transact([&]{
+        query.select({"_id"}).where(OP::EQ("_otype", 55)).cached().perform();
+    });
+    Q_ASSERT(ResultCache::size() == 0);
+
+    // nor read inside a transaction, that has it's own writes
+    const auto before = query.select({"_id"}).where(OP::EQ("_otype", 55)).cached().perform();
+    Q_ASSERT(ResultCache::size() == 1);
+    query.transact([&]{
+        // raw SQL keeps the committed state cached, like another thread could store it meanwhile
+        query.performSQL(QString("INSERT INTO %1 (_otype, guid, name) VALUES (55, '%2', '%3');")
+                            .arg(TARGET_TABLE, QUuid::createUuid().toString(), CACHE_NAME));
+        Q_ASSERT(ResultCache::size() == 1);
+
+        auto inside = query.select({"_id"}).where(OP::EQ("_otype", 55)).cached().perform();
+        Q_ASSERT(inside.count() == before.count() + 1);
+    });
+    Q_ASSERT(query.delete_(OP::EQ("name", CACHE_NAME)).perform());
+
+    // a result read before an invalidation is not stored after it
+    const quint64 generation = ResultCache::generation({TARGET_TABLE});
+    ResultCache::invalidate(TARGET_TABLE);
+    ResultCache::store(ResultCache::makeKey("stale", QVariantList()), {TARGET_TABLE}, before, generation);
+    Q_ASSERT(ResultCache::size() == 0);
+
+    // whitespace inside literals makes another statement
+    Q_ASSERT(ResultCache::makeKey("SELECT 'a  b'", QVariantList()) != ResultCache::makeKey("SELECT 'a b'", QVariantList()));
+    Q_ASSERT(ResultCache::makeKey("SELECT 1", {1}) == ResultCache::makeKey("SELECT 1", {1}));
+}
+
+void builder_test::test_parallel_select()
+{
+    const auto query = Query(TARGET_TABLE);
+
+    auto serial = query.select({"_id", "name"}).where(OP::GT("_otype", 0)).orderBy("_id", Order::ASC).perform();
+    Q_ASSERT(!query.hasError());
+
+    // same rows in the same order, whatever the number of parts
+    auto parallel = query.select({"_id", "name"}).where(OP::GT("_otype", 0)).orderBy("_id", Order::ASC).performParallel(4);
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(parallel == serial);
+
+    auto unordered = query.select({"_id", "name"}).where(OP::GT("_otype", 0)).performParallel(3);
+    Q_ASSERT(unordered == serial);
+
+    auto descending = query.select({"_id", "name"}).where(OP::GT("_otype", 0)).orderBy("_id", Order::DESC).performParallel(4);
+    std::reverse(serial.begin(), serial.end());
+    Q_ASSERT(descending == serial);
+
+    // the parts import the caller's snapshot
+    auto consistent = query.select({"_id", "name"}).where(OP::GT("_otype", 0)).performParallel(4, true);
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(consistent.count() == serial.count());
+
+    // can't be split by other orders, performed as usually
+    auto byName = query.select({"_id", "name"}).orderBy("name", Order::ASC).performParallel(4);
+    Q_ASSERT(byName == query.select({"_id", "name"}).orderBy("name", Order::ASC).perform());
+}
+
+void builder_test::test_aggregates()
+{
+    const auto query = Query(TARGET_TABLE);
+
+    auto rows = query.select({"_id", "_otype"}).where(OP::GT("_otype", 0)).perform();
+    Q_ASSERT(!query.hasError());
+
+    qint64 count = query.select().where(OP::GT("_otype", 0)).count();
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(count == rows.count());
+
+    Q_ASSERT(query.select().where(OP::GT("_otype", 0)).exists() == !rows.isEmpty());
+    Q_ASSERT(!query.select().where(OP::EQ("name", QUuid::createUuid().toString())).exists());
+    Q_ASSERT(!query.hasError());
+
+    int maxId = 0;
+    qint64 sum = 0;
+    for (const QVariant& row : rows)
+    {
+        maxId = qMax(maxId, row.toMap()["_id"].toInt());
+        sum += row.toMap()["_otype"].toLongLong();
+    }
+
+    QVariant max = query.select().where(OP::GT("_otype", 0)).aggregate(Aggregate::MAX, "_id");
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(max.toInt() == maxId);
+
+    QVariant total = query.select().where(OP::GT("_otype", 0)).aggregate(Aggregate::SUM, "_otype");
+    Q_ASSERT(total.toLongLong() == sum);
+
+    // grouped and limited queries are counted by their rows
+    auto groups = query.select({"_otype"}).where(OP::GT("_otype", 0)).groupBy("_otype").perform();
+    Q_ASSERT(query.select({"_otype"}).where(OP::GT("_otype", 0)).groupBy("_otype").count() == groups.count());
+    Q_ASSERT(query.select().where(OP::GT("_otype", 0)).limit(1).count() == qMin(1, rows.count()));
+
+    // so are DISTINCT and aggregate selections
+    auto distinct = query.select({"DISTINCT _otype"}).where(OP::GT("_otype", 0)).perform();
+    Q_ASSERT(query.select({"DISTINCT _otype"}).where(OP::GT("_otype", 0)).count() == distinct.count());
+    Q_ASSERT(query.select({"SUM(_otype) AS total"}).where(OP::GT("_otype", 0)).count() == 1);
+    Q_ASSERT(query.select({"SUM(_otype) AS total"}).where(OP::GT("_otype", 0)).aggregate(Aggregate::MAX, "total").toLongLong() == sum);
+
+    // joins are reused as well
+    const auto second_query = Query(SECOND_TABLE);
+    auto joined = second_query.select({"some_text", "name"}).join(TARGET_TABLE, {"some_fkey", "_id"}, Join::INNER).perform();
+    Q_ASSERT(second_query.select({"some_text", "name"}).join(TARGET_TABLE, {"some_fkey", "_id"}, Join::INNER).count() == joined.count());
+
+    // no rows -- null
+    Q_ASSERT(query.select().where(OP::EQ("name", QUuid::createUuid().toString())).aggregate(Aggregate::AVG, "_otype").isNull());
+}
+
+void builder_test::test_clause_tree()
+{
+    // same SQL as it has always been, values go in the placeholders' order
+    auto clause = (OP::EQ("a", 1) && OP::LT("b", 2)) || !OP::IS_NULL("c");
+    Q_ASSERT(clause.toSQL() == "((\"a\" = ?) AND (\"b\" < ?)) OR (NOT (\"c\" IS NULL))");
+    Q_ASSERT(clause.boundValues() == QVariantList({1, 2}));
+
+    auto right = OP::EQ("a", 1) && (OP::EQ("b", 2) || OP::EQ("c", 3));
+    Q_ASSERT(right.toSQL() == "(\"a\" = ?) AND ((\"b\" = ?) OR (\"c\" = ?))");
+    Q_ASSERT(right.boundValues() == QVariantList({1, 2, 3}));
+
+    // columns are nodes, qualified as a whole, values are never touched
+    auto qualified = OP::EQ("_id", "_id") && OP::EQ("_id_other", 5);
+    const QString sql = qualified.toSQL([](const QString& field) {
+        return field == "_id" ? QString("\"tbl\".\"_id\"") : QString();
+    });
+    Q_ASSERT(sql == "(\"tbl\".\"_id\" = ?) AND (\"_id_other\" = ?)");
+
+    Q_ASSERT(OP::Clause().isEmpty() && OP::Clause().toSQL().isEmpty());
+    Q_ASSERT((OP::Clause() && OP::EQ("a", 1)).toSQL() == "\"a\" = ?");
+
+    // long clauses are built in linear time
+    OP::Clause chain = OP::EQ("a", 0);
+    for (int i = 1; i < 10000; ++i)
+        chain = std::move(chain) && OP::EQ("a", i);
+    Q_ASSERT(chain.boundValues().count() == 10000);
+    Q_ASSERT(chain.boundValues().last() == 9999);
+
+    // ambiguous columns of the where are qualified, even if they are not selected
+    const auto second_query = Query(SECOND_TABLE);
+    second_query.select({"some_text"})
+            .join(TARGET_TABLE, {"some_fkey", "_id"}, Join::INNER)
+            .where(OP::GT("_id", 0) && OP::NEQ("some_text", "_id"))
+            .perform();
+    Q_ASSERT(!second_query.hasError());
+}
+
+void builder_test::test_static_query()
+{
+    using InsertObject = StaticInsert<SomeObjectTable, StaticColumns<SomeObjectType, SomeObjectGuid, SomeObjectName>>;
+    using ObjectsByName = StaticSelect<SomeObjectTable
+                                        , StaticColumns<SomeObjectId, SomeObjectName>
+                                        , StaticWhere<StaticOP::EQ<SomeObjectName>, StaticOP::GT<SomeObjectType>>
+                                        , StaticOrder<SomeObjectId, Order::DESC>>;
+    using RenameObject = StaticUpdate<SomeObjectTable, StaticColumns<SomeObjectName>, StaticWhere<StaticOP::EQ<SomeObjectId>>>;
+
+    // made once per shape
+    Q_ASSERT(&ObjectsByName::sql() == &ObjectsByName::sql());
+    Q_ASSERT(ObjectsByName::sql() == "SELECT \"_id\", \"name\" FROM some_object WHERE (\"name\" = ?) AND (\"_otype\" > ?) ORDER BY \"_id\" DESC;");
+    Q_ASSERT(InsertObject::sql() == "INSERT INTO some_object (\"_otype\",\"guid\",\"name\") VALUES (?,?,?) RETURNING _id;");
+
+    const auto query = Query(TARGET_TABLE);
+    const QString STATIC_NAME {"STATIC_TEST"};
+
+    QList<int> ids = InsertObject::perform(query, 77, QUuid::createUuid().toString(), STATIC_NAME);
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(ids.count() == 1);
+    ids << InsertObject::perform(query, 78, QUuid::createUuid().toString(), STATIC_NAME);
+
+    auto rows = ObjectsByName::perform(query, STATIC_NAME, 0);
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(rows.count() == 2);
+    Q_ASSERT(rows.first().toMap()["_id"].toInt() == ids.last());
+
+    // same rows as the dynamic generator gives
+    auto dynamic = query.select({"_id", "name"})
+                        .where(OP::EQ("name", STATIC_NAME) && OP::GT("_otype", 0))
+                        .orderBy("_id", Order::DESC)
+                        .perform();
+    Q_ASSERT(dynamic == rows);
+
+    bool ok = RenameObject::perform(query, "STATIC_RENAMED", ids.first());
+    Q_ASSERT(ok);
+    Q_ASSERT(ObjectsByName::perform(query, STATIC_NAME, 0).count() == 1);
+
+    // these do not compile: wrong arity and a value, that is not an int
+    // InsertObject::perform(query, 1, "guid");
+    // ObjectsByName::perform(query, STATIC_NAME, QString("0"));
+
+    query.delete_(OP::IN("_id", {ids.first(), ids.last()})).perform();
+    Q_ASSERT(!query.hasError());
+}
+
+void builder_test::test_escape_value()
+{
+    // all the lengths around the vector widths, all the byte values
+    for (int length = 0; length < 100; ++length)
+    {
+        QByteArray data;
+        QString text = " ";
+        for (int i = 0; i < length; ++i)
+        {
+            data.append(char((i * 37 + length) & 0xff));
+            text.append(i % 7 == 0 ? QChar('\'') : QChar(0x430 + i % 32));
+        }
+        text.append("\t");
+
+        Q_ASSERT(OP::Clause::escapeValue(data) == legacyEscapeValue(data));
+        Q_ASSERT(OP::Clause::escapeValue(text) == legacyEscapeValue(text));
+    }
+
+    Q_ASSERT(OP::Clause::escapeValue(QString("  it's  ")) == "'it''s'");
+    Q_ASSERT(OP::Clause::escapeValue(QByteArray("\x00\xff\x10", 3)) == "'00ff10'");
+    Q_ASSERT(OP::Clause::escapeValue(QString()) == "NULL");
+}
+
+void builder_test::bench_escape_value_data()
+{
+    QTest::addColumn<bool>("vectorized");
+    QTest::addColumn<QVariant>("value");
+
+    QByteArray blob(1 << 20, Qt::Uninitialized);
+    for (int i = 0; i < blob.size(); ++i)
+        blob[i] = char(i * 131);
+
+    QString text;
+    for (int i = 0; i < (1 << 18); ++i)
+        text.append(i % 100 == 0 ? QString("'") : QString("text"));
+
+    QTest::newRow("legacy blob")        << false << QVariant(blob);
+    QTest::newRow("vectorized blob")    << true  << QVariant(blob);
+    QTest::newRow("legacy text")        << false << QVariant(text);
+    QTest::newRow("vectorized text")    << true  << QVariant(text);
+}
+
+void builder_test::bench_escape_value()
+{
+    QFETCH(bool, vectorized);
+    QFETCH(QVariant, value);
+
+    QString result;
+    QBENCHMARK {
+        result = vectorized ? OP::Clause::escapeValue(value) : legacyEscapeValue(value);
+    }
+    Q_ASSERT(!result.isEmpty());
+}
+
+void builder_test::test_typed_clauses()
+{
+    // typed values are bound as they are
+    Q_ASSERT(OP::EQ("a", 5).boundValues().first().type() == QVariant::Int);
+    Q_ASSERT(OP::NEQ("a", qint64(1) << 40).boundValues().first().type() == QVariant::LongLong);
+    Q_ASSERT(OP::LT("a", 2.5).boundValues().first().type() == QVariant::Double);
+    Q_ASSERT(OP::GT("a", true).boundValues().first().type() == QVariant::Bool);
+    Q_ASSERT(OP::LE("a", QDate(2020, 1, 1)).boundValues().first().type() == QVariant::Date);
+    Q_ASSERT(OP::GE("a", QDateTime::currentDateTime()).boundValues().first().type() == QVariant::DateTime);
+    Q_ASSERT(OP::EQ("a", "text").boundValues().first() == QVariant(QString("text")));
+
+    const QUuid uuid = QUuid::createUuid();
+    Q_ASSERT(OP::EQ("a", uuid).boundValues().first() == QVariant(uuid.toString()));
+
+    // QVariant is the fallback, converted to text as before
+    Q_ASSERT(OP::EQ("a", QVariant(5)).boundValues().first().type() == QVariant::String);
+
+    // same rows either way
+    const auto query = Query(TARGET_TABLE);
+    auto typed = query.select({"_id"}).where(OP::GT("_otype", 0) && OP::LE("_id", 1000000)).perform();
+    Q_ASSERT(!query.hasError());
+    auto untyped = query.select({"_id"}).where(OP::GT("_otype", QVariant(0)) && OP::LE("_id", QVariant(1000000))).perform();
+    Q_ASSERT(typed == untyped);
+}
+
+void builder_test::test_in_arrays()
+{
+    const int threshold = Config::IN_ARRAY_THRESHOLD;
+    Config::IN_ARRAY_THRESHOLD = 3;
+
+    // short lists stay placeholders, long ones become one array parameter
+    QVariantList values;
+    Q_ASSERT(OP::IN("a", {1, 2}).toSQL(values, OP::Clause::ColumnResolver(), true) == "\"a\" IN (?,?)");
+    Q_ASSERT(values.count() == 2);
+
+    values.clear();
+    Q_ASSERT(OP::IN("a", {1, 2, 3}).toSQL(values, OP::Clause::ColumnResolver(), true) == "\"a\" = ANY(?)");
+    Q_ASSERT(values == QVariantList({"{1,2,3}"}));
+
+    values.clear();
+    Q_ASSERT(OP::NOT_IN("a", {"x", "it's \"q\"", QVariant()}).toSQL(values, OP::Clause::ColumnResolver(), true) == "\"a\" != ALL(?)");
+    Q_ASSERT(values == QVariantList({"{\"x\",\"it's \\\"q\\\"\",NULL}"}));
+
+    // other drivers always get placeholders
+    values.clear();
+    Q_ASSERT(OP::NOT_IN("a", {1, 2, 3}).toSQL(values, OP::Clause::ColumnResolver(), false) == "\"a\" NOT IN (?,?,?)");
+
+    // same rows either way
+    const auto query = Query(TARGET_TABLE);
+    auto all = query.select({"_id"}).orderBy("_id", Order::ASC).perform();
+    Q_ASSERT(!query.hasError());
+
+    QVariantList ids;
+    for (const QVariant& row : all)
+        ids << row.toMap()["_id"];
+
+    auto byArray = query.select({"_id"}).where(OP::IN("_id", ids)).orderBy("_id", Order::ASC).perform();
+    Q_ASSERT(!query.hasError());
+    auto notByArray = query.select({"_id"}).where(OP::NOT_IN("_id", ids)).perform();
+    Q_ASSERT(!query.hasError());
+
+    Config::IN_ARRAY_THRESHOLD = threshold;
+
+    auto byList = query.select({"_id"}).where(OP::IN("_id", ids)).orderBy("_id", Order::ASC).perform();
+    Q_ASSERT(byArray == byList && byList == all);
+    Q_ASSERT(notByArray.isEmpty());
+}
+
+void builder_test::test_copy_in()
+{
+    const auto query = Query(TARGET_TABLE);
+    const int before = int(query.select().count());
+    Q_ASSERT(!query.hasError());
+
+    const QString marker = QUuid::createUuid().toString();
+    const int rowCount = 2500;
+
+    QList<int> ids;
+    {
+        CopyInserter loader = query.copyIn({"_otype", "name", "guid", "descr"}).returnKeys();
+        for (int i = 0; i < rowCount; ++i)
+        {
+            // the separators & backslashes have to survive the text format
+            const QVariant descr = i % 2 == 0 ? QVariant(QString("tab\there\\n\nline %1").arg(i)) : QVariant();
+            Q_ASSERT(loader.add({i, marker, QUuid::createUuid().toString(), descr}));
+        }
+
+        Q_ASSERT(loader.finish() == rowCount);
+        ids = loader.keys();
+    }
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(ids.count() == rowCount);
+    Q_ASSERT(query.select().count() == before + rowCount);
+
+    auto first = query.select({"_otype", "descr"}).where(OP::EQ("_id", ids.first())).perform();
+    Q_ASSERT(first.count() == 1);
+    Q_ASSERT(first[0].toMap()["_otype"].toInt() == 0);
+    Q_ASSERT(first[0].toMap()["descr"].toString() == "tab\there\\n\nline 0");
+
+    auto second = query.select({"descr"}).where(OP::EQ("_id", ids[1])).perform();
+    Q_ASSERT(second.count() == 1 && second[0].toMap()["descr"].isNull());
+
+    // destroying an unfinished loader loads nothing
+    {
+        CopyInserter loader = query.copyIn({"_otype", "name", "guid"});
+        Q_ASSERT(loader.add({1, marker, QUuid::createUuid().toString()}));
+    }
+    Q_ASSERT(query.select().where(OP::EQ("name", marker)).count() == rowCount);
+
+    // so does replacing it by another one, the connection stays usable
+    {
+        CopyInserter loader = query.copyIn({"_otype", "name", "guid"});
+        Q_ASSERT(loader.add({1, marker, QUuid::createUuid().toString()}));
+
+        loader = query.copyIn({"_otype", "name", "guid"});
+        Q_ASSERT(loader.add({2, marker, QUuid::createUuid().toString()}));
+        Q_ASSERT(loader.finish() == 1);
+    }
+    Q_ASSERT(query.select().where(OP::EQ("name", marker)).count() == rowCount + 1);
+
+    Q_ASSERT(query.delete_(OP::EQ("name", marker)).perform());
+    Q_ASSERT(query.select().count() == before);
+}
+
+void builder_test::test_chunked_insert()
+{
+    const auto query = Query(TARGET_TABLE);
+    const int before = int(query.select().count());
+    Q_ASSERT(!query.hasError());
+
+    const QString marker = QUuid::createUuid().toString();
+    const int rowCount = 250;
+
+    // the source is pulled chunk by chunk, never more than one chunk at a time
+    int produced = 0;
+    auto source = [&produced, &marker, rowCount](QVariantList& row) {
+        if (produced == rowCount)
+            return false;
+
+        row = {produced++, marker, QUuid::createUuid().toString()};
+        return true;
+    };
+
+    QList<int> ids = query.insert({"_otype", "name", "guid"})
+                            .rows(source)
+                            .values({-1, marker, QUuid::createUuid().toString()})
+                            .chunked(40)
+                            .perform();
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(ids.count() == rowCount + 1);
+    Q_ASSERT(std::is_sorted(ids.begin(), ids.end()));
+
+    // values() rows go first
+    auto first = query.select({"_otype"}).where(OP::EQ("_id", ids.first())).perform();
+    Q_ASSERT(first.count() == 1 && first[0].toMap()["_otype"].toInt() == -1);
+
+    // a failing chunk rolls back the ones before it
+    produced = 0;
+    auto broken = [&produced, &marker](QVariantList& row) {
+        if (produced == 100)
+            return false;
+
+        row = {produced, marker, produced == 90 ? QVariant() : QVariant(QUuid::createUuid().toString())};
+        ++produced;
+        return true;
+    };
+
+    ids = query.insert({"_otype", "name", "guid"}).rows(broken).chunked(40).perform();
+    Q_ASSERT(query.hasError());
+    Q_ASSERT(ids.isEmpty());
+    Q_ASSERT(query.select().where(OP::EQ("name", marker)).count() == rowCount + 1);
+
+    Q_ASSERT(query.delete_(OP::EQ("name", marker)).perform());
+    Q_ASSERT(query.select().count() == before);
+}
+
+void builder_test::test_upsert()
+{
+    const auto query = Query(TARGET_TABLE);
+    const QString marker = QUuid::createUuid().toString();
+
+    QList<int> ids = query.insert({"_otype", "name", "guid"})
+                            .values({1, marker, QUuid::createUuid().toString()})
+                            .values({2, marker, QUuid::createUuid().toString()})
+                            .perform();
+    Q_ASSERT(!query.hasError() && ids.count() == 2);
+
+    // existing rows are updated by the primary key, all the other columns by default
+    const QString updated = QUuid::createUuid().toString();
+    QList<int> upserted = query.upsert({"_id", "_otype", "name", "guid"})
+                                .values({ids[0], 10, updated, QUuid::createUuid().toString()})
+                                .values({ids[1], 20, updated, QUuid::createUuid().toString()})
+                                .perform();
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(upserted == ids);
+    Q_ASSERT(query.select().where(OP::EQ("name", updated)).count() == 2);
+
+    // only the chosen columns are updated
+    upserted = query.upsert({"_id", "_otype", "name", "guid"})
+                        .onConflict({"_id"})
+                        .doUpdate({"_otype"})
+                        .values({ids[0], 30, marker, QUuid::createUuid().toString()})
+                        .perform();
+    Q_ASSERT(!query.hasError() && upserted == QList<int>({ids[0]}));
+
+    auto row = query.select({"_otype", "name"}).where(OP::EQ("_id", ids[0])).perform();
+    Q_ASSERT(row.count() == 1);
+    Q_ASSERT(row[0].toMap()["_otype"].toInt() == 30 && row[0].toMap()["name"].toString() == updated);
+
+    // skipped rows are not returned
+    upserted = query.upsert({"_id", "_otype", "name", "guid"})
+                        .doNothing()
+                        .values({ids[1], 40, marker, QUuid::createUuid().toString()})
+                        .perform();
+    Q_ASSERT(!query.hasError() && upserted.isEmpty());
+    Q_ASSERT(query.select().where(OP::EQ("_otype", 40)).count() == 0);
+
+    Q_ASSERT(query.delete_(OP::IN("_id", {ids[0], ids[1]})).perform());
+}
+
+void builder_test::test_exec_batch()
+{
+    const auto query = Query(TARGET_TABLE);
+    const int before = int(query.select().count());
+    const QString marker = QUuid::createUuid().toString();
+
+    int produced = 0;
+    auto source = [&produced, &marker](QVariantList& row) {
+        if (produced == 100)
+            return false;
+
+        row = {produced++, marker, QUuid::createUuid().toString()};
+        return true;
+    };
+
+    Q_ASSERT(query.insert({"_otype", "name", "guid"}).rows(source).chunked(30).performBatch());
+    Q_ASSERT(!query.hasError());
+    Q_ASSERT(query.select().where(OP::EQ("name", marker)).count() == 100);
+
+    // each row is found by the key & gets it's own values
+    auto rows = query.select({"_id", "_otype"}).where(OP::EQ("name", marker)).perform();
+
+    UpdaterBatch updater = query.updateBatch({"_id", "_otype", "descr"}, "_id");
+    for (const QVariant& row : rows)
+    {
+        const QVariantMap map = row.toMap();
+        updater = std::move(updater).values({map["_id"], map["_otype"].toInt() + 1000, QString("row %1").arg(map["_otype"].toInt())});
+    }
+
+    Q_ASSERT(std::move(updater).perform());
+    Q_ASSERT(!query.hasError());
+
+    auto updated = query.select({"_otype", "descr"}).where(OP::EQ("name", marker)).perform();
+    Q_ASSERT(updated.count() == 100);
+    for (const QVariant& row : updated)
+    {
+        const QVariantMap map = row.toMap();
+        Q_ASSERT(map["_otype"].toInt() >= 1000);
+        Q_ASSERT(map["descr"].toString() == QString("row %1").arg(map["_otype"].toInt() - 1000));
+    }
+
+    // the key has to be among the fields
+    Q_ASSERT(!query.updateBatch({"_otype"}, "_id").values({1}).perform());
+    Q_ASSERT(query.hasError());
+
+    // rows of a wrong length are not padded with NULLs
+    Q_ASSERT(!query.updateBatch({"_id", "_otype", "descr"}, "_id").values({rows.first().toMap()["_id"], 1}).perform());
+    Q_ASSERT(query.hasError());
+    Q_ASSERT(!query.insert({"_otype", "name", "guid"}).values({1, marker}).performBatch());
+    Q_ASSERT(query.hasError());
+    Q_ASSERT(query.select().where(OP::EQ("name", marker)).count() == 100);
+
+    // with separate transactions the chunks before a failure stay
+    produced = 0;
+    auto broken = [&produced, &marker](QVariantList& row) {
+        if (produced == 50)
+            return false;
+
+        row = {produced, marker, produced == 45 ? QVariant() : QVariant(QUuid::createUuid().toString())};
+        ++produced;
+        return true;
+    };
+    Q_ASSERT(!query.insert({"_otype", "name", "guid"}).rows(broken).chunked(20, false).performBatch());
+    Q_ASSERT(query.select().where(OP::EQ("name", marker)).count() == 140);
+
+    Q_ASSERT(query.delete_(OP::EQ("name", marker)).perform());
+    Q_ASSERT(query.select().count() == before);
+}
+
 QTEST_MAIN(builder_test)
 
 #include "tst_builder_test.moc"